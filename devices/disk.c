@@ -1,15 +1,25 @@
 #include "devices/disk.h"
 #include <ctype.h>
 #include <debug.h>
+#include <klog.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <string.h>
+#include "devices/ramdisk.h"
 #include "devices/timer.h"
+#include "devices/virtio-blk.h"
 #include "threads/io.h"
 #include "threads/interrupt.h"
 #include "threads/synch.h"
+#include "threads/thread.h"
 
 /* The code in this file is an interface to an ATA (IDE)
-   controller.  It attempts to comply to [ATA-3]. */
+   controller.  It attempts to comply to [ATA-3].  A virtio block
+   device may stand in for any of the IDE devices, in which case
+   devices/virtio-blk.c moves its data instead; requests are
+   queued and scheduled the same way either way.  A RAM disk
+   (devices/ramdisk.c) may stand in as well; its requests are
+   served right away, without queuing. */
 
 /* ATA command block port addresses. */
 #define reg_data(CHANNEL) ((CHANNEL)->reg_base + 0)     /* Data. */
@@ -48,17 +58,35 @@
 #define CMD_READ_SECTOR_RETRY 0x20      /* READ SECTOR with retries. */
 #define CMD_WRITE_SECTOR_RETRY 0x30     /* WRITE SECTOR with retries. */
 
-/* An ATA device. */
+/* Most sectors moved by a single ATA command.  Adjacent queued
+   requests are merged into one command up to this size. */
+#define DISK_MERGE_MAX 128
+
+/* Ticks a request may wait before it is served ahead of the
+   elevator order.  Reads usually have a thread blocked on them,
+   so they get the shorter deadline. */
+#define DISK_READ_DEADLINE (TIMER_FREQ / 20)
+#define DISK_WRITE_DEADLINE (TIMER_FREQ / 2)
+
+/* An ATA device, or the virtio block device or RAM disk in its
+   place. */
 struct disk {
 	char name[8];               /* Name, e.g. "hd0:1". */
 	struct channel *channel;    /* Channel disk is on. */
 	int dev_no;                 /* Device 0 or 1 for master or slave. */
 
 	bool is_ata;                /* 1=This device is an ATA disk. */
-	disk_sector_t capacity;     /* Capacity in sectors (if is_ata). */
+	struct virtio_blk *virtio;  /* Virtio block device, or NULL. */
+	struct ramdisk *ram;        /* RAM disk, or NULL. */
+	disk_sector_t capacity;     /* Capacity in sectors (if present). */
 
 	long long read_cnt;         /* Number of sectors read. */
 	long long write_cnt;        /* Number of sectors written. */
+
+	/* Per-class statistics, indexed by class and then by 0 for
+	   reads and 1 for writes. */
+	struct disk_stats stats[DISK_CLASS_CNT][2];
+	disk_sector_t last_end;     /* Sector just past the last request. */
 };
 
 /* An ATA channel (aka controller).
@@ -68,7 +96,14 @@ struct channel {
 	uint16_t reg_base;          /* Base I/O port. */
 	uint8_t irq;                /* Interrupt in use. */
 
-	struct lock lock;           /* Must acquire to access the controller. */
+	long long cmd_cnt;          /* Number of commands issued. */
+	int64_t busy_ticks;         /* Ticks spent with a command in progress. */
+
+	struct lock lock;           /* Protects QUEUE and HEAD. */
+	struct condition queue_nonempty;    /* Signaled when QUEUE gets a request. */
+	struct list queue;          /* Pending requests, oldest first. */
+	uint64_t head;              /* Position just past the last transfer. */
+
 	bool expecting_interrupt;   /* True if an interrupt is expected, false if
 								   any interrupt would be spurious. */
 	struct semaphore completion_wait;   /* Up'd by interrupt handler. */
@@ -80,11 +115,22 @@ struct channel {
 #define CHANNEL_CNT 2
 static struct channel channels[CHANNEL_CNT];
 
+/* Channel utilisation, for seeing how much I/O on the two
+   channels overlaps.  Updated with interrupts off. */
+static int busy_channel_cnt;        /* Channels with a command in progress. */
+static int64_t overlap_start;       /* When all channels last became busy. */
+static int64_t overlap_ticks;       /* Ticks spent with all channels busy. */
+static long long overlap_cmd_cnt;   /* Commands issued while another ran. */
+
+static bool is_present (const struct disk *);
 static void reset_channel (struct channel *);
 static bool check_device_type (struct disk *);
 static void identify_ata_device (struct disk *);
 
-static void select_sector (struct disk *, disk_sector_t);
+static void channel_worker (void *);
+static void ram_transfer (struct disk_request *);
+
+static void select_sectors (struct disk *, disk_sector_t, size_t cnt);
 static void issue_pio_command (struct channel *, uint8_t command);
 static void input_sector (struct channel *, void *);
 static void output_sector (struct channel *, const void *);
@@ -101,6 +147,9 @@ void
 disk_init (void) {
 	size_t chan_no;
 
+	virtio_blk_init ();
+	ramdisk_init ();
+
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
 		struct channel *c = &channels[chan_no];
 		int dev_no;
@@ -120,6 +169,11 @@ disk_init (void) {
 				NOT_REACHED ();
 		}
 		lock_init (&c->lock);
+		cond_init (&c->queue_nonempty);
+		list_init (&c->queue);
+		c->head = 0;
+		c->cmd_cnt = 0;
+		c->busy_ticks = 0;
 		c->expecting_interrupt = false;
 		sema_init (&c->completion_wait, 0);
 
@@ -131,9 +185,13 @@ disk_init (void) {
 			d->dev_no = dev_no;
 
 			d->is_ata = false;
+			d->virtio = NULL;
+			d->ram = NULL;
 			d->capacity = 0;
 
 			d->read_cnt = d->write_cnt = 0;
+			memset (d->stats, 0, sizeof d->stats);
+			d->last_end = 0;
 		}
 
 		/* Register interrupt handler. */
@@ -150,27 +208,123 @@ disk_init (void) {
 		for (dev_no = 0; dev_no < 2; dev_no++)
 			if (c->devices[dev_no].is_ata)
 				identify_ata_device (&c->devices[dev_no]);
+
+		/* A RAM disk or virtio block device takes the place of
+		   whatever IDE device it stands in for. */
+		for (dev_no = 0; dev_no < 2; dev_no++) {
+			struct disk *d = &c->devices[dev_no];
+			d->ram = ramdisk_get (chan_no, dev_no);
+			d->virtio = d->ram == NULL ? virtio_blk_get (chan_no, dev_no) : NULL;
+			if (d->ram != NULL) {
+				d->name[0] = 'r';
+				d->is_ata = false;
+				d->capacity = ramdisk_capacity (d->ram);
+			} else if (d->virtio != NULL) {
+				d->name[0] = 'v';
+				d->is_ata = false;
+				d->capacity = virtio_blk_capacity (d->virtio);
+			}
+		}
+
+		/* From now on only the channel's worker thread talks to the
+		   controller. */
+		if (is_present (&c->devices[0]) || is_present (&c->devices[1]))
+			thread_create (c->name, PRI_MAX, channel_worker, c);
 	}
 
 	/* DO NOT MODIFY BELOW LINES. */
 	register_disk_inspect_intr ();
 }
 
+/* Names of the request classes. */
+static const char *class_names[DISK_CLASS_CNT] = {
+	[DISK_OTHER] = "other",
+	[DISK_FILESYS] = "filesys",
+	[DISK_SWAP] = "swap",
+	[DISK_FSUTIL] = "fsutil",
+};
+
+/* Prints the DISK_HIST_CNT buckets of histogram HIST. */
+static void
+print_hist (const char *name, const long long hist[DISK_HIST_CNT]) {
+	int i;
+
+	printf ("  %s ticks:", name);
+	for (i = 0; i < DISK_HIST_CNT; i++)
+		printf (" %lld", hist[i]);
+	printf ("\n");
+}
+
+/* Prints the per-class statistics of disk D, one block for each
+   class and direction that saw any requests. */
+static void
+print_disk_stats (struct disk *d) {
+	int class, write;
+
+	for (class = 0; class < DISK_CLASS_CNT; class++)
+		for (write = 0; write < 2; write++) {
+			const struct disk_stats *s = &d->stats[class][write];
+			if (s->request_cnt == 0)
+				continue;
+			printf ("%s %s %s: %lld requests, %lld bytes, "
+					"%lld%% sequential\n",
+					d->name, class_names[class], write ? "writes" : "reads",
+					s->request_cnt, s->sector_cnt * DISK_SECTOR_SIZE,
+					s->seq_cnt * 100 / s->request_cnt);
+			print_hist ("wait", s->wait_hist);
+			print_hist ("service", s->service_hist);
+		}
+}
+
 /* Prints disk statistics. */
 void
 disk_print_stats (void) {
 	int chan_no;
 
 	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
+		struct channel *c = &channels[chan_no];
 		int dev_no;
 
 		for (dev_no = 0; dev_no < 2; dev_no++) {
 			struct disk *d = disk_get (chan_no, dev_no);
-			if (d != NULL && d->is_ata)
+			if (d != NULL)
 				printf ("%s: %lld reads, %lld writes\n",
 						d->name, d->read_cnt, d->write_cnt);
 		}
+		if (c->cmd_cnt > 0)
+			printf ("%s: %lld commands, busy for %"PRId64" ticks\n",
+					c->name, c->cmd_cnt, c->busy_ticks);
 	}
+	for (chan_no = 0; chan_no < CHANNEL_CNT; chan_no++) {
+		int dev_no;
+
+		for (dev_no = 0; dev_no < 2; dev_no++) {
+			struct disk *d = disk_get (chan_no, dev_no);
+			if (d != NULL)
+				print_disk_stats (d);
+		}
+	}
+	printf ("Disk channels: all busy for %"PRId64" ticks, "
+			"%lld commands overlapped\n", overlap_ticks, overlap_cmd_cnt);
+}
+
+/* Copies the statistics of D for requests of CLASS in the
+   direction given by WRITE into *STATS.
+   Returns false if CLASS is out of range. */
+bool
+disk_get_stats (struct disk *d, enum disk_class class, bool write,
+		struct disk_stats *stats) {
+	enum intr_level old_level;
+
+	ASSERT (d != NULL);
+
+	if ((unsigned) class >= DISK_CLASS_CNT)
+		return false;
+
+	old_level = intr_disable ();
+	*stats = d->stats[class][write];
+	intr_set_level (old_level);
+	return true;
 }
 
 /* Returns the disk numbered DEV_NO--either 0 or 1 for master or
@@ -188,12 +342,18 @@ disk_get (int chan_no, int dev_no) {
 
 	if (chan_no < (int) CHANNEL_CNT) {
 		struct disk *d = &channels[chan_no].devices[dev_no];
-		if (d->is_ata)
+		if (is_present (d))
 			return d;
 	}
 	return NULL;
 }
 
+/* Returns true if there is a disk, of any kind, at D. */
+static bool
+is_present (const struct disk *d) {
+	return d->is_ata || d->virtio != NULL || d->ram != NULL;
+}
+
 /* Returns the size of disk D, measured in DISK_SECTOR_SIZE-byte
    sectors. */
 disk_sector_t
@@ -203,27 +363,86 @@ disk_size (struct disk *d) {
 	return d->capacity;
 }
 
+/* Initializes R as a request to transfer CNT sectors starting at
+   SEC_NO between disk D and BUFFER, which must have room for CNT
+   * DISK_SECTOR_SIZE bytes.  The request writes to the disk if
+   WRITE is true, otherwise it reads, and is counted under CLASS
+   in D's statistics.  The caller may set R->done and R->aux
+   afterward to be called back on completion. */
+void
+disk_request_init (struct disk_request *r, struct disk *d, bool write,
+		enum disk_class class, disk_sector_t sec_no, void *buffer, size_t cnt) {
+	ASSERT (r != NULL);
+	ASSERT (d != NULL);
+	ASSERT (buffer != NULL);
+	ASSERT (cnt > 0 && cnt <= DISK_MERGE_MAX);
+	ASSERT (sec_no < d->capacity && d->capacity - sec_no >= cnt);
+
+	r->disk = d;
+	r->write = write;
+	r->class = class;
+	r->sec_no = sec_no;
+	r->buffer = buffer;
+	r->cnt = cnt;
+	r->done = NULL;
+	r->aux = NULL;
+	sema_init (&r->finished, 0);
+}
+
+/* Queues request R on its disk's channel and returns without
+   waiting for it.  R must stay valid until it completes, as
+   reported by disk_wait() or R->done. */
+void
+disk_submit (struct disk_request *r) {
+	struct channel *c = r->disk->channel;
+
+	r->submit_tick = timer_ticks ();
+	if (r->disk->ram != NULL) {
+		ram_transfer (r);
+		return;
+	}
+	r->deadline = r->submit_tick
+		+ (r->write ? DISK_WRITE_DEADLINE : DISK_READ_DEADLINE);
+
+	lock_acquire (&c->lock);
+	list_push_back (&c->queue, &r->elem);
+	cond_signal (&c->queue_nonempty, &c->lock);
+	lock_release (&c->lock);
+}
+
+/* Waits for submitted request R to complete. */
+void
+disk_wait (struct disk_request *r) {
+	sema_down (&r->finished);
+}
+
+/* Returns the class of plain disk_read() and disk_write() calls on
+   D, going by what Pintos uses D for (see disk_get()). */
+static enum disk_class
+default_class (const struct disk *d) {
+	int chan_no = d->channel - channels;
+
+	if (chan_no == 0 && d->dev_no == 1)
+		return DISK_FILESYS;
+	else if (chan_no == 1 && d->dev_no == 0)
+		return DISK_FSUTIL;
+	else if (chan_no == 1 && d->dev_no == 1)
+		return DISK_SWAP;
+	else
+		return DISK_OTHER;
+}
+
 /* Reads sector SEC_NO from disk D into BUFFER, which must have
    room for DISK_SECTOR_SIZE bytes.
    Internally synchronizes accesses to disks, so external
    per-disk locking is unneeded. */
 void
 disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
-	struct channel *c;
-
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
+	struct disk_request r;
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_READ_SECTOR_RETRY);
-	sema_down (&c->completion_wait);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk read failed, sector=%"PRDSNu, d->name, sec_no);
-	input_sector (c, buffer);
-	d->read_cnt++;
-	lock_release (&c->lock);
+	disk_request_init (&r, d, false, default_class (d), sec_no, buffer, 1);
+	disk_submit (&r);
+	disk_wait (&r);
 }
 
 /* Write sector SEC_NO to disk D from BUFFER, which must contain
@@ -233,23 +452,253 @@ disk_read (struct disk *d, disk_sector_t sec_no, void *buffer) {
    per-disk locking is unneeded. */
 void
 disk_write (struct disk *d, disk_sector_t sec_no, const void *buffer) {
-	struct channel *c;
+	struct disk_request r;
 
-	ASSERT (d != NULL);
-	ASSERT (buffer != NULL);
+	disk_request_init (&r, d, true, default_class (d), sec_no,
+			(void *) buffer, 1);
+	disk_submit (&r);
+	disk_wait (&r);
+}
 
-	c = d->channel;
-	lock_acquire (&c->lock);
-	select_sector (d, sec_no);
-	issue_pio_command (c, CMD_WRITE_SECTOR_RETRY);
-	if (!wait_while_busy (d))
-		PANIC ("%s: disk write failed, sector=%"PRDSNu, d->name, sec_no);
-	output_sector (c, buffer);
-	sema_down (&c->completion_wait);
-	d->write_cnt++;
-	lock_release (&c->lock);
+/* Request scheduling. */
+
+/* Returns the elevator position of the first sector of R.  The
+   two devices on a channel are laid end to end. */
+static uint64_t
+request_pos (const struct disk_request *r) {
+	return ((uint64_t) r->disk->dev_no << 32) | r->sec_no;
 }
-
+
+/* Removes the next request to serve from C's queue and returns
+   it.  Requests are served in C-LOOK order: the nearest one at
+   or past C's head, wrapping around to the lowest when none is.
+   A request whose deadline has passed goes first, so that a
+   stream of requests in one area of the disk cannot starve
+   another. */
+static struct disk_request *
+pick_request (struct channel *c) {
+	struct disk_request *oldest, *next = NULL, *lowest = NULL;
+	struct list_elem *e;
+
+	ASSERT (!list_empty (&c->queue));
+
+	oldest = list_entry (list_front (&c->queue), struct disk_request, elem);
+	if (timer_ticks () >= oldest->deadline)
+		next = oldest;
+	else
+		for (e = list_begin (&c->queue); e != list_end (&c->queue);
+				e = list_next (e)) {
+			struct disk_request *r = list_entry (e, struct disk_request, elem);
+			uint64_t pos = request_pos (r);
+
+			if (lowest == NULL || pos < request_pos (lowest))
+				lowest = r;
+			if (pos >= c->head && (next == NULL || pos < request_pos (next)))
+				next = r;
+		}
+	if (next == NULL)
+		next = lowest;
+
+	list_remove (&next->elem);
+	return next;
+}
+
+/* Moves requests from C's queue into BATCH, which holds requests
+   for consecutive sectors of one disk in one direction, as long
+   as they extend BATCH at either end and the total stays within
+   DISK_MERGE_MAX sectors.  *CNT is the number of sectors in
+   BATCH, updated as requests are added. */
+static void
+merge_requests (struct channel *c, struct list *batch, size_t *cnt) {
+	bool merged;
+
+	do {
+		struct disk_request *first, *last;
+		struct list_elem *e;
+
+		first = list_entry (list_front (batch), struct disk_request, elem);
+		last = list_entry (list_back (batch), struct disk_request, elem);
+		merged = false;
+		for (e = list_begin (&c->queue); e != list_end (&c->queue);
+				e = list_next (e)) {
+			struct disk_request *r = list_entry (e, struct disk_request, elem);
+
+			if (r->disk != first->disk || r->write != first->write
+					|| *cnt + r->cnt > DISK_MERGE_MAX)
+				continue;
+			if (r->sec_no == last->sec_no + last->cnt) {
+				list_remove (e);
+				list_push_back (batch, e);
+			} else if (r->sec_no + r->cnt == first->sec_no) {
+				list_remove (e);
+				list_push_front (batch, e);
+			} else
+				continue;
+			*cnt += r->cnt;
+			merged = true;
+			break;
+		}
+	} while (merged);
+}
+
+/* Returns the histogram bucket for a time of TICKS. */
+static int
+hist_bucket (int64_t ticks) {
+	int bucket = 0;
+
+	while (ticks > 0 && bucket < DISK_HIST_CNT - 1) {
+		ticks >>= 1;
+		bucket++;
+	}
+	return bucket;
+}
+
+/* Adds finished request R, whose transfer began at tick START, to
+   its disk's statistics. */
+static void
+account (struct disk_request *r, int64_t start) {
+	struct disk *d = r->disk;
+	struct disk_stats *s = &d->stats[r->class][r->write];
+	enum intr_level old_level;
+
+	old_level = intr_disable ();
+	s->request_cnt++;
+	s->sector_cnt += r->cnt;
+	if (r->sec_no == d->last_end)
+		s->seq_cnt++;
+	s->wait_hist[hist_bucket (start - r->submit_tick)]++;
+	s->service_hist[hist_bucket (timer_elapsed (start))]++;
+	d->last_end = r->sec_no + r->cnt;
+	intr_set_level (old_level);
+}
+
+/* Transfers the CNT consecutive sectors requested by the
+   requests in BATCH, all for ATA disk D, with a single ATA
+   command. */
+static void
+ata_transfer (struct disk *d, struct list *batch, size_t cnt) {
+	struct channel *c = d->channel;
+	struct disk_request *first;
+	struct list_elem *e;
+
+	first = list_entry (list_front (batch), struct disk_request, elem);
+	select_sectors (d, first->sec_no, cnt);
+	issue_pio_command (c, first->write
+			? CMD_WRITE_SECTOR_RETRY : CMD_READ_SECTOR_RETRY);
+	for (e = list_begin (batch); e != list_end (batch); e = list_next (e)) {
+		struct disk_request *r = list_entry (e, struct disk_request, elem);
+		uint8_t *buffer = r->buffer;
+		size_t i;
+
+		for (i = 0; i < r->cnt; i++, buffer += DISK_SECTOR_SIZE)
+			if (r->write) {
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk write failed, sector=%"PRDSNu,
+							d->name, (disk_sector_t) (r->sec_no + i));
+				output_sector (c, buffer);
+				sema_down (&c->completion_wait);
+			} else {
+				sema_down (&c->completion_wait);
+				if (!wait_while_busy (d))
+					PANIC ("%s: disk read failed, sector=%"PRDSNu,
+							d->name, (disk_sector_t) (r->sec_no + i));
+				input_sector (c, buffer);
+			}
+	}
+}
+
+/* Transfers the CNT consecutive sectors requested by the
+   requests in BATCH with a single command, then completes each
+   request. */
+static void
+transfer (struct channel *c, struct list *batch, size_t cnt) {
+	struct disk_request *first;
+	struct disk *d;
+	enum intr_level old_level;
+	int64_t start;
+
+	first = list_entry (list_front (batch), struct disk_request, elem);
+	d = first->disk;
+
+	old_level = intr_disable ();
+	start = timer_ticks ();
+	if (busy_channel_cnt++ > 0)
+		overlap_cmd_cnt++;
+	if (busy_channel_cnt == CHANNEL_CNT)
+		overlap_start = start;
+	intr_set_level (old_level);
+
+	if (d->virtio != NULL)
+		virtio_blk_transfer (d->virtio, batch);
+	else
+		ata_transfer (d, batch, cnt);
+	if (first->write)
+		d->write_cnt += cnt;
+	else
+		d->read_cnt += cnt;
+
+	old_level = intr_disable ();
+	c->cmd_cnt++;
+	c->busy_ticks += timer_elapsed (start);
+	if (busy_channel_cnt-- == CHANNEL_CNT)
+		overlap_ticks += timer_elapsed (overlap_start);
+	intr_set_level (old_level);
+
+	while (!list_empty (batch)) {
+		struct disk_request *r = list_entry (list_pop_front (batch),
+				struct disk_request, elem);
+		account (r, start);
+		if (r->done != NULL)
+			r->done (r);
+		sema_up (&r->finished);
+	}
+}
+
+/* Serves request R, for a RAM disk, in the caller's thread.
+   There is nothing to schedule or wait for, so this is just a
+   copy. */
+static void
+ram_transfer (struct disk_request *r) {
+	struct disk *d = r->disk;
+
+	ramdisk_transfer (d->ram, r->write, r->sec_no, r->buffer, r->cnt);
+	if (r->write)
+		d->write_cnt += r->cnt;
+	else
+		d->read_cnt += r->cnt;
+
+	account (r, r->submit_tick);
+	if (r->done != NULL)
+		r->done (r);
+	sema_up (&r->finished);
+}
+
+/* Serves the requests queued on channel C_, forever. */
+static void
+channel_worker (void *c_) {
+	struct channel *c = c_;
+
+	for (;;) {
+		struct disk_request *r, *last;
+		struct list batch;
+		size_t cnt;
+
+		lock_acquire (&c->lock);
+		while (list_empty (&c->queue))
+			cond_wait (&c->queue_nonempty, &c->lock);
+		r = pick_request (c);
+		list_init (&batch);
+		list_push_back (&batch, &r->elem);
+		cnt = r->cnt;
+		merge_requests (c, &batch, &cnt);
+		last = list_entry (list_back (&batch), struct disk_request, elem);
+		c->head = request_pos (last) + last->cnt;
+		lock_release (&c->lock);
+
+		transfer (c, &batch, cnt);
+	}
+}
+
 /* Disk detection and identification. */
 
 static void print_ata_string (char *string, size_t size);
@@ -402,17 +851,18 @@ print_ata_string (char *string, size_t size) {
 }
 
 /* Selects device D, waiting for it to become ready, and then
-   writes SEC_NO to the disk's sector selection registers.  (We
-   use LBA mode.) */
+   writes SEC_NO and CNT to the disk's sector selection registers.
+   (We use LBA mode.) */
 static void
-select_sector (struct disk *d, disk_sector_t sec_no) {
+select_sectors (struct disk *d, disk_sector_t sec_no, size_t cnt) {
 	struct channel *c = d->channel;
 
 	ASSERT (sec_no < d->capacity);
 	ASSERT (sec_no < (1UL << 28));
+	ASSERT (cnt > 0 && cnt < 256);
 
 	select_device_wait (d);
-	outb (reg_nsect (c), 1);
+	outb (reg_nsect (c), cnt);
 	outb (reg_lbal (c), sec_no);
 	outb (reg_lbam (c), sec_no >> 8);
 	outb (reg_lbah (c), (sec_no >> 16));
@@ -522,7 +972,7 @@ interrupt_handler (struct intr_frame *f) {
 				inb (reg_status (c));               /* Acknowledge interrupt. */
 				sema_up (&c->completion_wait);      /* Wake up waiter. */
 			} else
-				printf ("%s: unexpected interrupt\n", c->name);
+				klog (KLOG_WARN, "%s: unexpected interrupt", c->name);
 			return;
 		}
 
@@ -0,0 +1,112 @@
+#include "devices/ramdisk.h"
+#include <debug.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "threads/palloc.h"
+#include "threads/vaddr.h"
+
+/* A RAM disk stands in for one of the IDE devices, holding its
+   sectors in kernel memory reserved at boot.  It starts out
+   zeroed and its contents are lost at power off, so it suits
+   swap, or a file system disk that is formatted with -f and
+   filled from the scratch disk.  Its pages come from the kernel
+   pool, leaving the user pool, and with it paging behavior, the
+   same as with IDE. */
+
+/* A RAM disk. */
+struct ramdisk {
+	int chan_no;                /* IDE channel it stands in on. */
+	int dev_no;                 /* IDE device it stands in for. */
+	size_t page_cnt;            /* Size in pages. */
+	uint8_t *data;              /* Contents. */
+};
+
+/* RAM disks requested on the command line. */
+#define RAMDISK_MAX 4
+static struct ramdisk ramdisks[RAMDISK_MAX];
+static size_t ramdisk_cnt;
+
+/* Adds a RAM disk as requested by SPEC, the value of a
+   -ramdisk=CHAN:DEV:SIZE option: IDE device DEV on channel CHAN
+   is replaced by a SIZE MB RAM disk.  Called before the page
+   allocator is up, so the memory is only reserved later, by
+   ramdisk_init(). */
+void
+ramdisk_configure (char *spec) {
+	char *chan, *dev, *size, *save_ptr;
+	struct ramdisk *rd;
+	int mb;
+
+	if (spec == NULL || ramdisk_cnt >= RAMDISK_MAX)
+		PANIC ("bad -ramdisk option (use -h for help)");
+	chan = strtok_r (spec, ":", &save_ptr);
+	dev = strtok_r (NULL, ":", &save_ptr);
+	size = strtok_r (NULL, "", &save_ptr);
+	if (chan == NULL || dev == NULL || size == NULL)
+		PANIC ("bad -ramdisk option (use -h for help)");
+
+	rd = &ramdisks[ramdisk_cnt++];
+	rd->chan_no = atoi (chan);
+	rd->dev_no = atoi (dev);
+	mb = atoi (size);
+	if (rd->chan_no < 0 || rd->chan_no > 1 || rd->dev_no < 0 || rd->dev_no > 1
+			|| (rd->chan_no == 0 && rd->dev_no == 0))
+		PANIC ("-ramdisk: can't replace disk %s:%s", chan, dev);
+	if (mb <= 0)
+		PANIC ("-ramdisk: bad size %s", size);
+	rd->page_cnt = (size_t) mb * 1024 * 1024 / PGSIZE;
+	rd->data = NULL;
+}
+
+/* Reserves and zeroes the memory of each configured RAM disk. */
+void
+ramdisk_init (void) {
+	size_t i;
+
+	for (i = 0; i < ramdisk_cnt; i++) {
+		struct ramdisk *rd = &ramdisks[i];
+
+		rd->data = palloc_get_multiple (PAL_ZERO, rd->page_cnt);
+		if (rd->data == NULL)
+			PANIC ("rd%d:%d: not enough memory for %zu kB RAM disk",
+					rd->chan_no, rd->dev_no, rd->page_cnt * PGSIZE / 1024);
+		printf ("rd%d:%d: %zu kB RAM disk\n",
+				rd->chan_no, rd->dev_no, rd->page_cnt * PGSIZE / 1024);
+	}
+}
+
+/* Returns the RAM disk that stands in for IDE device DEV_NO on
+   channel CHAN_NO, or a null pointer if there is none. */
+struct ramdisk *
+ramdisk_get (int chan_no, int dev_no) {
+	size_t i;
+
+	for (i = 0; i < ramdisk_cnt; i++)
+		if (ramdisks[i].chan_no == chan_no && ramdisks[i].dev_no == dev_no
+				&& ramdisks[i].data != NULL)
+			return &ramdisks[i];
+	return NULL;
+}
+
+/* Returns the size of RD, measured in DISK_SECTOR_SIZE-byte
+   sectors. */
+disk_sector_t
+ramdisk_capacity (const struct ramdisk *rd) {
+	return rd->page_cnt * (PGSIZE / DISK_SECTOR_SIZE);
+}
+
+/* Copies CNT sectors starting at SEC_NO between RD and BUFFER,
+   into RD if WRITE is true, out of it otherwise. */
+void
+ramdisk_transfer (struct ramdisk *rd, bool write, disk_sector_t sec_no,
+		void *buffer, size_t cnt) {
+	uint8_t *sector = rd->data + (size_t) sec_no * DISK_SECTOR_SIZE;
+
+	ASSERT (sec_no + cnt <= ramdisk_capacity (rd));
+
+	if (write)
+		memcpy (sector, buffer, cnt * DISK_SECTOR_SIZE);
+	else
+		memcpy (buffer, sector, cnt * DISK_SECTOR_SIZE);
+}
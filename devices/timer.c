@@ -3,8 +3,10 @@
 #include <inttypes.h>
 #include <round.h>
 #include <stdio.h>
+#include "threads/apic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
+#include "threads/profile.h"
 #include "threads/synch.h"
 #include "threads/thread.h"
 
@@ -29,11 +31,16 @@ static bool too_many_loops (unsigned loops);
 static void busy_wait (int64_t loops);
 static void real_time_sleep (int64_t num, int32_t denom);
 
-/* Sets up the 8254 Programmable Interval Timer (PIT) to
-   interrupt PIT_FREQ times per second, and registers the
-   corresponding interrupt. */
+/* Sets up the local APIC timer or, without the APICs, the 8254
+   Programmable Interval Timer (PIT) to interrupt TIMER_FREQ times
+   per second, and registers the corresponding interrupt. */
 void
 timer_init (void) {
+	if (apic_timer_start (0x20, TIMER_FREQ)) {
+		intr_register_ext (0x20, timer_interrupt, "Local APIC Timer");
+		return;
+	}
+
 	/* 8254 input frequency divided by TIMER_FREQ, rounded to
 	   nearest. */
 	uint16_t count = (1193180 + TIMER_FREQ / 2) / TIMER_FREQ;
@@ -123,8 +130,9 @@ timer_print_stats (void) {
 
 /* Timer interrupt handler. */
 static void
-timer_interrupt (struct intr_frame *args UNUSED) {
+timer_interrupt (struct intr_frame *args) {
 	ticks++;
+	profile_sample (args);
 	thread_tick ();
 	if (get_global_ticks () <= ticks)
 		thread_awake (ticks);
@@ -0,0 +1,358 @@
+#include "devices/virtio-blk.h"
+#include <debug.h>
+#include <round.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/apic.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* The code in this file drives virtio block devices through the
+   legacy PCI interface of [VIRTIO-0.9.5].  Each device has one
+   virtqueue.  A request is a chain of descriptors: a header
+   naming the operation and first sector, one descriptor for each
+   buffer to transfer, and a status byte the device fills in.  A
+   whole batch of consecutive sectors thus moves in a single
+   request, by DMA, and its completion is signaled by an
+   interrupt, instead of the CPU copying every sector through an
+   I/O port as with ATA PIO.
+
+   The pintos launcher attaches the disk that would otherwise be
+   IDE device CHAN:DEV at PCI slot VIRTIO_SLOT_BASE + CHAN * 2 +
+   DEV, which is how disk_get() finds it. */
+
+/* PCI configuration space, reached through configuration
+   mechanism #1. */
+#define PCI_CONFIG_ADDR 0xcf8
+#define PCI_CONFIG_DATA 0xcfc
+#define PCI_SLOT_CNT 32
+
+#define PCI_ID 0x00                     /* Vendor and device ID. */
+#define PCI_COMMAND 0x04                /* Command register. */
+#define PCI_BAR0 0x10                   /* Base address register 0. */
+#define PCI_INTR 0x3c                   /* Interrupt line. */
+
+#define PCI_COMMAND_IO 0x1              /* Respond to I/O space. */
+#define PCI_COMMAND_MASTER 0x4          /* Allow bus mastering (DMA). */
+
+/* Transitional virtio block device. */
+#define VIRTIO_VENDOR 0x1af4
+#define VIRTIO_BLK_DEVICE 0x1001
+
+/* Slot of the device standing in for IDE device 0:0. */
+#define VIRTIO_SLOT_BASE 0x10
+
+/* Legacy virtio registers, as offsets into I/O BAR 0. */
+#define reg_host_features(V) ((V)->io_base + 0x00)
+#define reg_guest_features(V) ((V)->io_base + 0x04)
+#define reg_queue_pfn(V) ((V)->io_base + 0x08)
+#define reg_queue_size(V) ((V)->io_base + 0x0c)
+#define reg_queue_sel(V) ((V)->io_base + 0x0e)
+#define reg_queue_notify(V) ((V)->io_base + 0x10)
+#define reg_status(V) ((V)->io_base + 0x12)
+#define reg_isr(V) ((V)->io_base + 0x13)
+#define reg_capacity(V) ((V)->io_base + 0x14)   /* 64 bits. */
+#define reg_seg_max(V) ((V)->io_base + 0x20)
+
+/* Device status bits. */
+#define STATUS_ACKNOWLEDGE 0x01         /* Guest found the device. */
+#define STATUS_DRIVER 0x02              /* Guest can drive it. */
+#define STATUS_DRIVER_OK 0x04           /* Driver is ready. */
+#define STATUS_FAILED 0x80              /* Guest gave up. */
+
+/* Feature bits. */
+#define VIRTIO_BLK_F_SEG_MAX (1 << 2)   /* SEG_MAX register is valid. */
+
+#define ISR_QUEUE 0x1                   /* Used ring was updated. */
+
+/* Virtqueue descriptor flags. */
+#define VRING_DESC_F_NEXT 0x1           /* NEXT is valid. */
+#define VRING_DESC_F_WRITE 0x2          /* Device writes the buffer. */
+
+/* Request types and status. */
+#define VIRTIO_BLK_T_IN 0               /* Read. */
+#define VIRTIO_BLK_T_OUT 1              /* Write. */
+#define VIRTIO_BLK_S_OK 0               /* Success. */
+
+/* Descriptors a request needs besides its data buffers. */
+#define VIRTIO_BLK_OVERHEAD 2
+
+/* A virtqueue descriptor. */
+struct vring_desc {
+	uint64_t addr;                  /* Physical address of buffer. */
+	uint32_t len;                   /* Buffer length in bytes. */
+	uint16_t flags;                 /* VRING_DESC_F_*. */
+	uint16_t next;                  /* Next descriptor in chain. */
+};
+
+/* Ring of descriptor chains made available to the device. */
+struct vring_avail {
+	uint16_t flags;
+	uint16_t idx;                   /* Where the next chain goes. */
+	uint16_t ring[];
+};
+
+/* A chain the device is done with. */
+struct vring_used_elem {
+	uint32_t id;                    /* First descriptor of chain. */
+	uint32_t len;                   /* Bytes written by device. */
+};
+
+/* Ring of descriptor chains the device is done with. */
+struct vring_used {
+	uint16_t flags;
+	uint16_t idx;                   /* Where the next chain goes. */
+	struct vring_used_elem ring[];
+};
+
+/* Header of a virtio-blk request. */
+struct virtio_blk_header {
+	uint32_t type;                  /* VIRTIO_BLK_T_*. */
+	uint32_t reserved;
+	uint64_t sector;                /* First sector. */
+};
+
+/* A virtio block device. */
+struct virtio_blk {
+	uint8_t slot;                   /* PCI slot. */
+	uint16_t io_base;               /* Base I/O port. */
+	uint8_t irq;                    /* Interrupt in use. */
+	disk_sector_t capacity;         /* Capacity in sectors. */
+	size_t seg_max;                 /* Most data buffers per request. */
+
+	/* The virtqueue.  Only one request is ever in flight, so its
+	   chain always starts at descriptor 0. */
+	uint16_t queue_size;            /* Number of descriptors. */
+	struct vring_desc *desc;        /* Descriptor table. */
+	volatile struct vring_avail *avail;
+	volatile struct vring_used *used;
+	uint16_t last_used;             /* Used ring index last seen. */
+
+	struct virtio_blk_header header;        /* Header of request. */
+	volatile uint8_t status;                /* Status of request. */
+	struct semaphore completion_wait;       /* Up'd by interrupt handler. */
+};
+
+/* Devices found, in the order of their slots. */
+#define VIRTIO_BLK_MAX 4
+static struct virtio_blk devices[VIRTIO_BLK_MAX];
+static size_t device_cnt;
+
+static intr_handler_func interrupt_handler;
+
+/* Returns the configuration register at byte offset REG of the
+   device in SLOT on PCI bus 0. */
+static uint32_t
+pci_read (int slot, int reg) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (slot << 11) | reg);
+	return inl (PCI_CONFIG_DATA);
+}
+
+/* Sets the configuration register at byte offset REG of the
+   device in SLOT on PCI bus 0 to VALUE. */
+static void
+pci_write (int slot, int reg, uint32_t value) {
+	outl (PCI_CONFIG_ADDR, 0x80000000 | (slot << 11) | reg);
+	outl (PCI_CONFIG_DATA, value);
+}
+
+/* A virtqueue with SIZE descriptors is laid out as
+   [VIRTIO-0.9.5] 2.3 requires: the descriptor table and the
+   available ring, then the used ring starting on a new page.
+   These return the bytes of each part. */
+static size_t
+avail_part_bytes (uint16_t size) {
+	return ROUND_UP (sizeof (struct vring_desc) * size
+			+ sizeof (struct vring_avail) + sizeof (uint16_t) * (size + 1),
+			PGSIZE);
+}
+
+static size_t
+used_part_bytes (uint16_t size) {
+	return ROUND_UP (sizeof (struct vring_used)
+			+ sizeof (struct vring_used_elem) * size + sizeof (uint16_t),
+			PGSIZE);
+}
+
+/* Brings up the virtio block device V, whose SLOT, IO_BASE, and
+   IRQ are set.  Returns false if it cannot be used. */
+static bool
+setup_device (struct virtio_blk *v) {
+	uint32_t features;
+	uint64_t capacity;
+	uint8_t *queue;
+
+	outb (reg_status (v), 0);
+	outb (reg_status (v), STATUS_ACKNOWLEDGE | STATUS_DRIVER);
+	features = inl (reg_host_features (v)) & VIRTIO_BLK_F_SEG_MAX;
+	outl (reg_guest_features (v), features);
+
+	outw (reg_queue_sel (v), 0);
+	v->queue_size = inw (reg_queue_size (v));
+	if (v->queue_size <= VIRTIO_BLK_OVERHEAD)
+		goto fail;
+	queue = palloc_get_multiple (PAL_ZERO, (avail_part_bytes (v->queue_size)
+				+ used_part_bytes (v->queue_size)) / PGSIZE);
+	if (queue == NULL)
+		goto fail;
+	v->desc = (struct vring_desc *) queue;
+	v->avail = (struct vring_avail *) (queue
+			+ sizeof (struct vring_desc) * v->queue_size);
+	v->used = (struct vring_used *) (queue
+			+ avail_part_bytes (v->queue_size));
+	v->last_used = 0;
+	outl (reg_queue_pfn (v), vtop (queue) >> PGBITS);
+
+	v->seg_max = v->queue_size - VIRTIO_BLK_OVERHEAD;
+	if (features & VIRTIO_BLK_F_SEG_MAX) {
+		uint32_t seg_max = inl (reg_seg_max (v));
+		if (seg_max > 0 && seg_max < v->seg_max)
+			v->seg_max = seg_max;
+	}
+
+	capacity = inl (reg_capacity (v))
+		| ((uint64_t) inl (reg_capacity (v) + 4) << 32);
+	v->capacity = capacity > UINT32_MAX ? UINT32_MAX : capacity;
+	sema_init (&v->completion_wait, 0);
+
+	outb (reg_status (v),
+			STATUS_ACKNOWLEDGE | STATUS_DRIVER | STATUS_DRIVER_OK);
+	return true;
+
+fail:
+	outb (reg_status (v), STATUS_FAILED);
+	return false;
+}
+
+/* Finds the virtio block devices on PCI bus 0 and sets them up. */
+void
+virtio_blk_init (void) {
+	int slot;
+
+	for (slot = 0; slot < PCI_SLOT_CNT && device_cnt < VIRTIO_BLK_MAX;
+			slot++) {
+		struct virtio_blk *v = &devices[device_cnt];
+		uint32_t bar;
+		size_t i;
+
+		if (pci_read (slot, PCI_ID) != (VIRTIO_BLK_DEVICE << 16 | VIRTIO_VENDOR))
+			continue;
+
+		bar = pci_read (slot, PCI_BAR0);
+		if ((bar & 1) == 0)
+			continue;
+		pci_write (slot, PCI_COMMAND, pci_read (slot, PCI_COMMAND)
+				| PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+		v->slot = slot;
+		v->io_base = bar & ~3;
+		v->irq = pci_read (slot, PCI_INTR) & 0xff;
+		if (v->irq == 0 || v->irq >= 16 || !setup_device (v))
+			continue;
+		device_cnt++;
+
+		/* Devices may share an interrupt line, and with it a
+		   handler. */
+		for (i = 0; i < device_cnt - 1; i++)
+			if (devices[i].irq == v->irq)
+				break;
+		if (i == device_cnt - 1) {
+			apic_set_level_triggered (v->irq);
+			intr_register_ext (0x20 + v->irq, interrupt_handler, "virtio-blk");
+		}
+
+		printf ("virtio-blk at slot %d: %'"PRDSNu" sectors, "
+				"%zu segments per request\n", slot, v->capacity, v->seg_max);
+	}
+}
+
+/* Returns the virtio block device that stands in for IDE device
+   DEV_NO on channel CHAN_NO, or a null pointer if there is none. */
+struct virtio_blk *
+virtio_blk_get (int chan_no, int dev_no) {
+	size_t i;
+
+	for (i = 0; i < device_cnt; i++)
+		if (devices[i].slot == VIRTIO_SLOT_BASE + chan_no * 2 + dev_no)
+			return &devices[i];
+	return NULL;
+}
+
+/* Returns the size of V, measured in DISK_SECTOR_SIZE-byte
+   sectors. */
+disk_sector_t
+virtio_blk_capacity (const struct virtio_blk *v) {
+	return v->capacity;
+}
+
+/* Points descriptor I of V at SIZE bytes at kernel virtual
+   address BUFFER, with FLAGS, chaining it to descriptor I + 1 if
+   NEXT is true. */
+static void
+set_desc (struct virtio_blk *v, uint16_t i, const volatile void *buffer,
+		uint32_t size, uint16_t flags, bool next) {
+	struct vring_desc *d = &v->desc[i];
+
+	d->addr = vtop (buffer);
+	d->len = size;
+	d->flags = flags | (next ? VRING_DESC_F_NEXT : 0);
+	d->next = next ? i + 1 : 0;
+}
+
+/* Transfers the consecutive sectors requested by the requests in
+   BATCH, which all go in the same direction, between V and the
+   requests' buffers.  Each virtio-blk request carries as many of
+   the buffers as V accepts, so a batch usually takes just one.
+   Called only by the disk's channel thread. */
+void
+virtio_blk_transfer (struct virtio_blk *v, struct list *batch) {
+	struct list_elem *e = list_begin (batch);
+
+	ASSERT (intr_get_level () == INTR_ON);
+
+	while (e != list_end (batch)) {
+		struct disk_request *first = list_entry (e, struct disk_request, elem);
+		uint16_t flags = first->write ? 0 : VRING_DESC_F_WRITE;
+		uint16_t i = 1;
+
+		v->header.type = first->write ? VIRTIO_BLK_T_OUT : VIRTIO_BLK_T_IN;
+		v->header.reserved = 0;
+		v->header.sector = first->sec_no;
+		set_desc (v, 0, &v->header, sizeof v->header, 0, true);
+		for (; e != list_end (batch) && i <= v->seg_max; e = list_next (e)) {
+			struct disk_request *r = list_entry (e, struct disk_request, elem);
+			set_desc (v, i++, r->buffer, r->cnt * DISK_SECTOR_SIZE, flags, true);
+		}
+		v->status = 0xff;
+		set_desc (v, i, &v->status, 1, VRING_DESC_F_WRITE, false);
+
+		/* Publish the chain, then tell the device about it. */
+		v->avail->ring[v->avail->idx % v->queue_size] = 0;
+		barrier ();
+		v->avail->idx++;
+		barrier ();
+		outw (reg_queue_notify (v), 0);
+
+		sema_down (&v->completion_wait);
+		if (v->status != VIRTIO_BLK_S_OK)
+			PANIC ("virtio-blk at slot %d: %s failed, sector=%"PRDSNu,
+					v->slot, first->write ? "write" : "read", first->sec_no);
+	}
+}
+
+/* Virtio block interrupt handler.  Reading the ISR acknowledges
+   the interrupt and lowers the shared line. */
+static void
+interrupt_handler (struct intr_frame *f) {
+	struct virtio_blk *v;
+
+	for (v = devices; v < devices + device_cnt; v++)
+		if (f->vec_no == (uint64_t) (0x20 + v->irq)
+				&& (inb (reg_isr (v)) & ISR_QUEUE) != 0
+				&& v->used->idx != v->last_used) {
+			v->last_used = v->used->idx;
+			sema_up (&v->completion_wait);
+		}
+}
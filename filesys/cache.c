@@ -0,0 +1,486 @@
+/* cache.c: Buffer cache for file system sectors. */
+
+#include "filesys/cache.h"
+#include <debug.h>
+#include <string.h>
+#include "filesys/filesys.h"
+#include "threads/synch.h"
+
+/* A cached sector.
+ *
+ * An entry either caches disk sector SECTOR, or, if INODE is
+ * non-null, holds data written to sector IDX of INODE for which
+ * no disk sector has been chosen yet.  Such a "delayed" entry is
+ * never evicted; the inode layer must first assign it a sector
+ * with cache_assign_delayed() or drop it.
+ *
+ * An entry is pinned while its sector is read from or written to
+ * disk, which happens with the cache lock released.  LOADING and
+ * WRITING tell others what the transfer is: an entry that is
+ * loading holds no data yet, but one being written back may still
+ * be read and written. */
+struct cache_entry {
+	bool in_use;                        /* Holds valid data? */
+	bool dirty;                         /* Needs to be written back? */
+	bool accessed;                      /* Recently used, for clock. */
+	bool loading;                       /* Being read from disk? */
+	bool writing;                       /* Being written to disk? */
+	int pin_cnt;                        /* Copies and transfers in progress. */
+	disk_sector_t sector;               /* Cached disk sector. */
+	const struct inode *inode;          /* Owner of delayed data, or NULL. */
+	disk_sector_t idx;                  /* File sector index of delayed data. */
+	struct disk_request req;            /* Transfer in progress. */
+	uint8_t data[DISK_SECTOR_SIZE];     /* Sector contents. */
+};
+
+static struct cache_entry cache[CACHE_SIZE];
+
+/* Protects every entry's bookkeeping.  Entry data is copied in and
+ * out, and moved to and from disk, with the lock released, while
+ * the entry is pinned. */
+static struct lock cache_lock;
+
+/* Signaled whenever a transfer to or from disk finishes, an entry
+ * is unpinned, or a delayed entry becomes evictable or free. */
+static struct condition io_done;
+
+static size_t clock_hand;           /* Next entry the clock examines. */
+static size_t delayed_cnt;          /* Number of delayed entries. */
+
+/* Initializes the buffer cache. */
+void
+cache_init (void) {
+	lock_init (&cache_lock);
+	cond_init (&io_done);
+}
+
+/* Writes every dirty sector back to disk at shutdown. */
+void
+cache_done (void) {
+	cache_flush ();
+}
+
+/* Starts writing entry E, which must be dirty, back to disk and
+ * pins it until finish_write().
+ * E must cache a disk sector, not delayed data. */
+static void
+start_write (struct cache_entry *e) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+	ASSERT (e->inode == NULL && e->dirty && !e->writing);
+
+	/* Writes to E from now on make it dirty again, so that they
+	 * are not lost if they miss this write. */
+	e->dirty = false;
+	e->writing = true;
+	e->pin_cnt++;
+	disk_request_init (&e->req, filesys_disk, true, DISK_FILESYS, e->sector,
+			e->data, 1);
+	disk_submit (&e->req);
+}
+
+/* Waits for a write started by start_write() to finish, with the
+ * cache lock released meanwhile. */
+static void
+finish_write (struct cache_entry *e) {
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+
+	lock_release (&cache_lock);
+	disk_wait (&e->req);
+	lock_acquire (&cache_lock);
+	e->writing = false;
+	e->pin_cnt--;
+	cond_broadcast (&io_done, &cache_lock);
+}
+
+/* Writes entry E, which must be dirty, back to disk, releasing
+ * the cache lock for the duration. */
+static void
+write_back (struct cache_entry *e) {
+	start_write (e);
+	finish_write (e);
+}
+
+/* Writes every dirty sector in the cache back to disk.
+ * Delayed data is left alone. */
+void
+cache_flush (void) {
+	cache_flush_range (0, disk_size (filesys_disk));
+}
+
+/* Returns true if E caches one of the CNT sectors starting at
+ * START. */
+static bool
+in_range (const struct cache_entry *e, disk_sector_t start, size_t cnt) {
+	return e->in_use && e->inode == NULL
+		&& e->sector >= start && e->sector - start < cnt;
+}
+
+/* Returns true if one of the CNT sectors starting at START is
+ * being written back. */
+static bool
+writing_range (disk_sector_t start, size_t cnt) {
+	size_t i;
+
+	for (i = 0; i < CACHE_SIZE; i++)
+		if (in_range (&cache[i], start, cnt) && cache[i].writing)
+			return true;
+	return false;
+}
+
+/* Writes the dirty cached sectors among the CNT sectors starting
+ * at START back to disk, and returns once they are there.
+ * All of them are submitted before waiting for any, so that the
+ * disk can merge runs of adjacent sectors into single commands. */
+void
+cache_flush_range (disk_sector_t start, size_t cnt) {
+	struct cache_entry *batch[CACHE_SIZE];
+	size_t batch_cnt = 0;
+	size_t i;
+
+	lock_acquire (&cache_lock);
+
+	/* Sectors already on their way to disk may hold older data
+	 * than the cache now does.  Let them land first. */
+	while (writing_range (start, cnt))
+		cond_wait (&io_done, &cache_lock);
+
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (in_range (e, start, cnt) && e->dirty) {
+			start_write (e);
+			batch[batch_cnt++] = e;
+		}
+	}
+	for (i = 0; i < batch_cnt; i++)
+		finish_write (batch[i]);
+	lock_release (&cache_lock);
+}
+
+/* Drops any cached copies of the CNT sectors starting at START
+ * without writing them back, because the disk was just written
+ * behind the cache's back and they are stale. */
+void
+cache_invalidate_range (disk_sector_t start, size_t cnt) {
+	size_t i = 0;
+
+	lock_acquire (&cache_lock);
+	while (i < CACHE_SIZE) {
+		struct cache_entry *e = &cache[i];
+		if (in_range (e, start, cnt)) {
+			if (e->pin_cnt > 0) {
+				/* Let the copy or transfer finish, then look at this
+				 * entry again, since it may have been reused. */
+				cond_wait (&io_done, &cache_lock);
+				continue;
+			}
+			e->in_use = false;
+		}
+		i++;
+	}
+	lock_release (&cache_lock);
+}
+
+/* Returns the entry caching SECTOR, or a null pointer. */
+static struct cache_entry *
+lookup (disk_sector_t sector) {
+	size_t i;
+
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->in_use && e->inode == NULL && e->sector == sector)
+			return e;
+	}
+	return NULL;
+}
+
+/* Returns the delayed entry for sector IDX of INODE, or a null
+ * pointer. */
+static struct cache_entry *
+lookup_delayed (const struct inode *inode, disk_sector_t idx) {
+	size_t i;
+
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->in_use && e->inode == inode && e->idx == idx)
+			return e;
+	}
+	return NULL;
+}
+
+/* Chooses an entry to reuse with the clock algorithm, writing its
+ * old contents back if necessary, and returns it unused.
+ * Pinned and delayed entries are skipped.  The cache lock may be
+ * released and reacquired, while writing back or while waiting
+ * for a pinned entry to come free. */
+static struct cache_entry *
+evict (void) {
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+
+	for (i = 0; ; i++) {
+		struct cache_entry *e = &cache[clock_hand];
+		clock_hand = (clock_hand + 1) % CACHE_SIZE;
+
+		if (!e->in_use)
+			return e;
+		if (i >= 3 * CACHE_SIZE) {
+			/* Every entry is pinned or delayed.  Wait for a copy or
+			 * transfer to finish. */
+			cond_wait (&io_done, &cache_lock);
+			i = 0;
+		}
+		if (e->pin_cnt > 0 || e->inode != NULL)
+			continue;
+		if (e->accessed) {
+			e->accessed = false;
+			continue;
+		}
+		if (e->dirty) {
+			/* Someone may use E while it is written back, in which
+			 * case it is kept. */
+			write_back (e);
+			if (e->pin_cnt > 0 || e->accessed || e->dirty)
+				continue;
+		}
+		e->in_use = false;
+		return e;
+	}
+}
+
+/* Returns the pinned entry caching SECTOR, loading it first if it
+ * is not cached.  If FILL is false the caller is about to
+ * overwrite the whole sector, so the disk is not read.
+ * The cache lock is released while the sector is read. */
+static struct cache_entry *
+get (disk_sector_t sector, bool fill) {
+	struct cache_entry *e;
+
+	ASSERT (lock_held_by_current_thread (&cache_lock));
+
+	for (;;) {
+		e = lookup (sector);
+		if (e != NULL && e->loading)
+			cond_wait (&io_done, &cache_lock);
+		else if (e != NULL) {
+			e->accessed = true;
+			e->pin_cnt++;
+			return e;
+		} else {
+			/* evict() may release the lock, and SECTOR may be cached
+			 * by someone else meanwhile.  If so, E stays unused. */
+			e = evict ();
+			if (lookup (sector) == NULL)
+				break;
+		}
+	}
+
+	e->in_use = true;
+	e->dirty = false;
+	e->accessed = true;
+	e->pin_cnt = 1;
+	e->sector = sector;
+	e->inode = NULL;
+	if (fill) {
+		e->loading = true;
+		lock_release (&cache_lock);
+		disk_request_init (&e->req, filesys_disk, false, DISK_FILESYS, sector,
+				e->data, 1);
+		disk_submit (&e->req);
+		disk_wait (&e->req);
+		lock_acquire (&cache_lock);
+		e->loading = false;
+		cond_broadcast (&io_done, &cache_lock);
+	}
+	return e;
+}
+
+/* Unpins E, marking it dirty if DIRTY is true. */
+static void
+unpin (struct cache_entry *e, bool dirty) {
+	lock_acquire (&cache_lock);
+	if (dirty)
+		e->dirty = true;
+	if (--e->pin_cnt == 0)
+		cond_broadcast (&io_done, &cache_lock);
+	lock_release (&cache_lock);
+}
+
+/* Copies the contents of sector SRC to sector DST, whose old
+ * contents are not read. */
+void
+cache_copy (disk_sector_t dst, disk_sector_t src) {
+	struct cache_entry *s, *d;
+
+	ASSERT (dst != src);
+
+	/* S is pinned, so getting D cannot evict it. */
+	lock_acquire (&cache_lock);
+	s = get (src, true);
+	d = get (dst, false);
+	lock_release (&cache_lock);
+
+	memcpy (d->data, s->data, DISK_SECTOR_SIZE);
+	unpin (s, false);
+	unpin (d, true);
+}
+
+/* Reads SIZE bytes starting at byte OFS of SECTOR into BUFFER. */
+void
+cache_read (disk_sector_t sector, void *buffer, int ofs, int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	e = get (sector, true);
+	lock_release (&cache_lock);
+
+	memcpy (buffer, e->data + ofs, size);
+	unpin (e, false);
+}
+
+/* Writes SIZE bytes from BUFFER to SECTOR starting at byte OFS.
+ * The data reaches the disk when the entry is evicted or
+ * flushed. */
+void
+cache_write (disk_sector_t sector, const void *buffer, int ofs, int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	e = get (sector, ofs != 0 || size != DISK_SECTOR_SIZE);
+	lock_release (&cache_lock);
+
+	memcpy (e->data + ofs, buffer, size);
+	unpin (e, true);
+}
+
+/* Reads SIZE bytes at byte OFS of the delayed buffer for sector
+ * IDX of INODE into BUFFER.
+ * Returns false, reading nothing, if there is no such buffer. */
+bool
+cache_read_delayed (const struct inode *inode, disk_sector_t idx,
+		void *buffer, int ofs, int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	e = lookup_delayed (inode, idx);
+	if (e != NULL) {
+		e->accessed = true;
+		e->pin_cnt++;
+	}
+	lock_release (&cache_lock);
+
+	if (e == NULL)
+		return false;
+	memcpy (buffer, e->data + ofs, size);
+	unpin (e, false);
+	return true;
+}
+
+/* Creates a zeroed delayed buffer for sector IDX of INODE, which
+ * must not have one yet.
+ * Returns false if CACHE_DELAYED_MAX buffers are already
+ * delayed. */
+bool
+cache_add_delayed (const struct inode *inode, disk_sector_t idx) {
+	struct cache_entry *e = NULL;
+
+	ASSERT (inode != NULL);
+
+	lock_acquire (&cache_lock);
+	ASSERT (lookup_delayed (inode, idx) == NULL);
+	if (delayed_cnt < CACHE_DELAYED_MAX) {
+		/* Count the entry first, since evict() may release the
+		 * lock. */
+		delayed_cnt++;
+		e = evict ();
+		e->in_use = true;
+		e->dirty = true;
+		e->accessed = true;
+		e->pin_cnt = 0;
+		e->inode = inode;
+		e->idx = idx;
+		memset (e->data, 0, DISK_SECTOR_SIZE);
+	}
+	lock_release (&cache_lock);
+
+	return e != NULL;
+}
+
+/* Writes SIZE bytes from BUFFER at byte OFS of the delayed buffer
+ * for sector IDX of INODE.
+ * Returns false, writing nothing, if there is no such buffer. */
+bool
+cache_write_delayed (const struct inode *inode, disk_sector_t idx,
+		const void *buffer, int ofs, int size) {
+	struct cache_entry *e;
+
+	ASSERT (ofs >= 0 && size >= 0 && ofs + size <= DISK_SECTOR_SIZE);
+
+	lock_acquire (&cache_lock);
+	e = lookup_delayed (inode, idx);
+	if (e != NULL) {
+		e->accessed = true;
+		e->pin_cnt++;
+	}
+	lock_release (&cache_lock);
+
+	if (e == NULL)
+		return false;
+	memcpy (e->data + ofs, buffer, size);
+	unpin (e, true);
+	return true;
+}
+
+/* Turns the delayed buffer for sector IDX of INODE into a dirty
+ * buffer for disk sector SECTOR, which was just allocated. */
+void
+cache_assign_delayed (const struct inode *inode, disk_sector_t idx,
+		disk_sector_t sector) {
+	struct cache_entry *e, *stale;
+
+	lock_acquire (&cache_lock);
+	e = lookup_delayed (inode, idx);
+	if (e != NULL) {
+		/* SECTOR may still be cached from a file that owned it
+		 * before.  Those contents are dead, but if they are being
+		 * written back, the write must land before E's can, and
+		 * anyone loading or copying them must be done before the
+		 * entry is dropped. */
+		while ((stale = lookup (sector)) != NULL
+				&& (stale->writing || stale->loading || stale->pin_cnt > 0))
+			cond_wait (&io_done, &cache_lock);
+		if (stale != NULL)
+			stale->in_use = false;
+
+		e->inode = NULL;
+		e->sector = sector;
+		e->dirty = true;
+		delayed_cnt--;
+		cond_broadcast (&io_done, &cache_lock);
+	}
+	lock_release (&cache_lock);
+}
+
+/* Drops every delayed buffer that belongs to INODE. */
+void
+cache_discard_delayed (const struct inode *inode) {
+	size_t i;
+
+	lock_acquire (&cache_lock);
+	for (i = 0; i < CACHE_SIZE; i++) {
+		struct cache_entry *e = &cache[i];
+		if (e->in_use && e->inode == inode) {
+			ASSERT (e->pin_cnt == 0);
+			e->in_use = false;
+			delayed_cnt--;
+			cond_broadcast (&io_done, &cache_lock);
+		}
+	}
+	lock_release (&cache_lock);
+}
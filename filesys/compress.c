@@ -0,0 +1,196 @@
+/* compress.c: LZ77 compression for file data.
+ *
+ * A compressed block is a series of sequences.  Each sequence is a
+ * token byte, whose high nibble is a count of literal bytes and
+ * whose low nibble is a match length minus MIN_MATCH, followed by
+ * the literal bytes, then a 2-byte little-endian offset back into
+ * the output at which the match begins.  A nibble of 15 means
+ * that more length bytes follow the token (for literals) or the
+ * offset (for the match), each adding its value, until one is less
+ * than 255.  The last sequence stops after its literals. */
+
+#include "filesys/compress.h"
+#include <debug.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+/* Shortest match worth encoding. */
+#define MIN_MATCH 4
+
+/* Farthest back a match may start. */
+#define MAX_OFFSET 65535
+
+/* Size of the table of recently seen positions, as a power of 2. */
+#define HASH_BITS 12
+
+static inline uint32_t
+read32 (const uint8_t *p) {
+	uint32_t v;
+	memcpy (&v, p, sizeof v);
+	return v;
+}
+
+static inline size_t
+hash (uint32_t v) {
+	return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+/* Appends the extra bytes for length LEN to OP, which may not
+ * reach OEND.  Returns the new end of output, or a null pointer if
+ * there is no room. */
+static uint8_t *
+put_length (uint8_t *op, const uint8_t *oend, size_t len) {
+	for (; len >= 255; len -= 255) {
+		if (op == oend)
+			return NULL;
+		*op++ = 255;
+	}
+	if (op == oend)
+		return NULL;
+	*op++ = len;
+	return op;
+}
+
+/* Adds the extra bytes at *IP, which may not reach IEND, to *LEN.
+ * Returns false if they run past IEND. */
+static bool
+get_length (const uint8_t **ip, const uint8_t *iend, size_t *len) {
+	uint8_t b;
+
+	do {
+		if (*ip == iend)
+			return false;
+		b = *(*ip)++;
+		*len += b;
+	} while (b == 255);
+	return true;
+}
+
+/* Appends a sequence of LIT_LEN literal bytes from LIT, followed by
+ * a match of MATCH_LEN bytes OFFSET bytes back, to OP, which may
+ * not reach OEND.  A MATCH_LEN of 0 ends the block.
+ * Returns the new end of output, or a null pointer if there is no
+ * room. */
+static uint8_t *
+emit (uint8_t *op, const uint8_t *oend, const uint8_t *lit, size_t lit_len,
+		size_t offset, size_t match_len) {
+	uint8_t *token;
+
+	if (op == oend)
+		return NULL;
+	token = op++;
+	*token = (lit_len < 15 ? lit_len : 15) << 4;
+	if (lit_len >= 15 && (op = put_length (op, oend, lit_len - 15)) == NULL)
+		return NULL;
+	if ((size_t) (oend - op) < lit_len)
+		return NULL;
+	memcpy (op, lit, lit_len);
+	op += lit_len;
+
+	if (match_len > 0) {
+		size_t len = match_len - MIN_MATCH;
+
+		if (oend - op < 2)
+			return NULL;
+		*op++ = offset & 0xff;
+		*op++ = offset >> 8;
+		*token |= len < 15 ? len : 15;
+		if (len >= 15 && (op = put_length (op, oend, len - 15)) == NULL)
+			return NULL;
+	}
+	return op;
+}
+
+/* Compresses the SIZE bytes at SRC into DST, which has room for
+ * CAP bytes, using the COMPRESS_WORK_SIZE bytes at WORK as scratch
+ * space.  SIZE may be at most COMPRESS_MAX.
+ * Returns the size of the compressed data, or 0 if it does not fit
+ * in CAP bytes. */
+size_t
+compress (const void *src_, size_t size, void *dst_, size_t cap,
+		void *work) {
+	const uint8_t *src = src_;
+	const uint8_t *end = src + size;
+	const uint8_t *ip = src, *anchor = src;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint16_t *table = work;
+
+	ASSERT (size <= COMPRESS_MAX);
+	ASSERT ((sizeof *table << HASH_BITS) <= COMPRESS_WORK_SIZE);
+
+	memset (table, 0, sizeof *table << HASH_BITS);
+	while (end - ip >= MIN_MATCH) {
+		uint32_t v = read32 (ip);
+		size_t h = hash (v);
+		const uint8_t *ref = src + table[h];
+		const uint8_t *m, *r;
+
+		table[h] = ip - src;
+		if (ref >= ip || ip - ref > MAX_OFFSET || read32 (ref) != v) {
+			ip++;
+			continue;
+		}
+
+		/* Extend the match as far as it goes. */
+		for (m = ip + MIN_MATCH, r = ref + MIN_MATCH; m < end && *m == *r;
+				m++, r++)
+			continue;
+
+		op = emit (op, dst + cap, anchor, ip - anchor, ip - ref, m - ip);
+		if (op == NULL)
+			return 0;
+		ip = anchor = m;
+	}
+
+	op = emit (op, dst + cap, anchor, end - anchor, 0, 0);
+	return op != NULL ? (size_t) (op - dst) : 0;
+}
+
+/* Decompresses the SIZE bytes at SRC, which compress() produced,
+ * into DST, which has room for CAP bytes.
+ * Returns the size of the decompressed data, or 0 if SRC is
+ * corrupt or its data does not fit in CAP bytes. */
+size_t
+decompress (const void *src_, size_t size, void *dst_, size_t cap) {
+	const uint8_t *ip = src_;
+	const uint8_t *iend = ip + size;
+	uint8_t *dst = dst_;
+	uint8_t *op = dst;
+	uint8_t *oend = dst + cap;
+
+	while (ip < iend) {
+		unsigned token = *ip++;
+		size_t len = token >> 4;
+		size_t offset;
+		const uint8_t *ref;
+
+		/* Literals. */
+		if (len == 15 && !get_length (&ip, iend, &len))
+			return 0;
+		if (len > (size_t) (iend - ip) || len > (size_t) (oend - op))
+			return 0;
+		memcpy (op, ip, len);
+		op += len;
+		ip += len;
+		if (ip == iend)
+			break;
+
+		/* Match, which may overlap its own output. */
+		if (iend - ip < 2)
+			return 0;
+		offset = ip[0] | ip[1] << 8;
+		ip += 2;
+		len = token & 15;
+		if (len == 15 && !get_length (&ip, iend, &len))
+			return 0;
+		len += MIN_MATCH;
+		if (offset == 0 || offset > (size_t) (op - dst)
+				|| len > (size_t) (oend - op))
+			return 0;
+		for (ref = op - offset; len > 0; len--)
+			*op++ = *ref++;
+	}
+	return op - dst;
+}
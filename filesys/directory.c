@@ -19,6 +19,10 @@ struct dir_entry {
 	bool in_use;                        /* In use or free? */
 };
 
+/* Number of entries that dir_getdents() reads at a time, about a
+ * sector's worth. */
+#define GETDENTS_BATCH (DISK_SECTOR_SIZE / sizeof (struct dir_entry))
+
 /* Creates a directory with space for ENTRY_CNT entries in the
  * given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -214,3 +218,48 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1]) {
 	}
 	return false;
 }
+
+/* Stores up to CNT of the entries in DIR that are in use, starting
+ * at byte offset *POS, in ENTS, and advances *POS past the last
+ * entry examined.  Unlike dir_readdir(), reads the directory about
+ * a sector at a time rather than one entry at a time.
+ * Returns the number of entries stored, which is 0 at the end of
+ * the directory or if memory is short. */
+size_t
+dir_getdents (struct dir *dir, off_t *pos, struct dirent *ents, size_t cnt) {
+	struct dir_entry *batch;
+	size_t n = 0;
+
+	ASSERT (dir != NULL);
+	ASSERT (*pos >= 0);
+
+	if (*pos % sizeof *batch != 0)
+		return 0;
+
+	batch = malloc (GETDENTS_BATCH * sizeof *batch);
+	if (batch == NULL)
+		return 0;
+
+	while (n < cnt) {
+		off_t bytes = inode_read_at (dir->inode, batch,
+				GETDENTS_BATCH * sizeof *batch, *pos);
+		size_t batch_cnt = bytes / sizeof *batch;
+		size_t i;
+
+		if (batch_cnt == 0)
+			break;
+		for (i = 0; i < batch_cnt && n < cnt; i++) {
+			struct dir_entry *e = &batch[i];
+			if (e->in_use) {
+				ents[n].inumber = e->inode_sector;
+				ents[n].type = DT_REG;
+				strlcpy (ents[n].name, e->name, sizeof ents[n].name);
+				n++;
+			}
+		}
+		*pos += i * sizeof *batch;
+	}
+
+	free (batch);
+	return n;
+}
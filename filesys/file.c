@@ -8,8 +8,18 @@ struct file {
 	struct inode *inode;        /* File's inode. */
 	off_t pos;                  /* Current position. */
 	bool deny_write;            /* Has file_deny_write() been called? */
+	bool direct;                /* Bypass the buffer cache when possible? */
 };
 
+/* Returns true if a transfer of SIZE bytes at byte offset OFS of
+ * FILE should bypass the buffer cache: FILE is in direct I/O
+ * mode and the transfer covers whole sectors. */
+static bool
+use_direct (const struct file *file, off_t size, off_t ofs) {
+	return file->direct
+		&& size % DISK_SECTOR_SIZE == 0 && ofs % DISK_SECTOR_SIZE == 0;
+}
+
 /* Opens a file for the given INODE, of which it takes ownership,
  * and returns the new file.  Returns a null pointer if an
  * allocation fails or if INODE is null. */
@@ -20,6 +30,7 @@ file_open (struct inode *inode) {
 		file->inode = inode;
 		file->pos = 0;
 		file->deny_write = false;
+		file->direct = false;
 		return file;
 	} else {
 		inode_close (inode);
@@ -42,6 +53,7 @@ file_duplicate (struct file *file) {
 	struct file *nfile = file_open (inode_reopen (file->inode));
 	if (nfile) {
 		nfile->pos = file->pos;
+		nfile->direct = file->direct;
 		if (file->deny_write)
 			file_deny_write (nfile);
 	}
@@ -71,7 +83,7 @@ file_get_inode (struct file *file) {
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_read (struct file *file, void *buffer, off_t size) {
-	off_t bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	off_t bytes_read = file_read_at (file, buffer, size, file->pos);
 	file->pos += bytes_read;
 	return bytes_read;
 }
@@ -86,16 +98,33 @@ file_read_at (struct file *file, void *buffer, off_t size, off_t file_ofs) {
 	return inode_read_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Reads SIZE bytes from FILE into BUFFER, starting at the file's
+ * current position, like file_read().  If FILE is in direct I/O
+ * mode and the transfer covers whole sectors, the data moves
+ * between the disk and BUFFER without the buffer cache.  The disk
+ * driver's own thread does that transfer, so BUFFER must be a
+ * kernel address that stays mapped until this returns. */
+off_t
+file_read_direct (struct file *file, void *buffer, off_t size) {
+	off_t bytes_read;
+
+	if (use_direct (file, size, file->pos))
+		bytes_read = inode_read_direct (file->inode, buffer, size, file->pos);
+	else
+		bytes_read = inode_read_at (file->inode, buffer, size, file->pos);
+	file->pos += bytes_read;
+	return bytes_read;
+}
+
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at the file's current position.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk fills up.
+ * Writing past end of file grows the file.
  * Advances FILE's position by the number of bytes read. */
 off_t
 file_write (struct file *file, const void *buffer, off_t size) {
-	off_t bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+	off_t bytes_written = file_write_at (file, buffer, size, file->pos);
 	file->pos += bytes_written;
 	return bytes_written;
 }
@@ -103,9 +132,8 @@ file_write (struct file *file, const void *buffer, off_t size) {
 /* Writes SIZE bytes from BUFFER into FILE,
  * starting at offset FILE_OFS in the file.
  * Returns the number of bytes actually written,
- * which may be less than SIZE if end of file is reached.
- * (Normally we'd grow the file in that case, but file growth is
- * not yet implemented.)
+ * which may be less than SIZE if the disk fills up.
+ * Writing past end of file grows the file.
  * The file's current position is unaffected. */
 off_t
 file_write_at (struct file *file, const void *buffer, off_t size,
@@ -113,6 +141,23 @@ file_write_at (struct file *file, const void *buffer, off_t size,
 	return inode_write_at (file->inode, buffer, size, file_ofs);
 }
 
+/* Writes SIZE bytes from BUFFER into FILE, starting at the file's
+ * current position, like file_write().  Bypasses the buffer cache
+ * under the same conditions as file_read_direct(), and BUFFER
+ * must likewise be a kernel address. */
+off_t
+file_write_direct (struct file *file, const void *buffer, off_t size) {
+	off_t bytes_written;
+
+	if (use_direct (file, size, file->pos))
+		bytes_written = inode_write_direct (file->inode, buffer, size,
+				file->pos);
+	else
+		bytes_written = inode_write_at (file->inode, buffer, size, file->pos);
+	file->pos += bytes_written;
+	return bytes_written;
+}
+
 /* Prevents write operations on FILE's underlying inode
  * until file_allow_write() is called or FILE is closed. */
 void
@@ -159,3 +204,67 @@ file_tell (struct file *file) {
 	ASSERT (file != NULL);
 	return file->pos;
 }
+
+/* Puts FILE in direct I/O mode if DIRECT is true, or takes it out
+ * of it otherwise.  In direct I/O mode, file_read_direct() and
+ * file_write_direct() of whole sectors move data between the
+ * caller's buffer and the disk without passing through, or
+ * evicting anything from, the buffer cache.  Other reads and
+ * writes still go through the cache. */
+void
+file_set_direct (struct file *file, bool direct) {
+	ASSERT (file != NULL);
+	file->direct = direct;
+}
+
+/* Returns true if FILE is in direct I/O mode. */
+bool
+file_is_direct (struct file *file) {
+	ASSERT (file != NULL);
+	return file->direct;
+}
+
+/* Makes FILE store its data compressed from now on.
+ * Returns false if FILE is not empty. */
+bool
+file_set_compressed (struct file *file) {
+	ASSERT (file != NULL);
+	return inode_set_compressed (file->inode);
+}
+
+/* Forces FILE's data and metadata to disk.
+ * Returns false if the disk is too full to hold its data. */
+bool
+file_sync (struct file *file) {
+	ASSERT (file != NULL);
+	return inode_sync (file->inode, false);
+}
+
+/* Like file_sync(), but skips writing FILE's inode unless that is
+ * needed to read the data back. */
+bool
+file_datasync (struct file *file) {
+	ASSERT (file != NULL);
+	return inode_sync (file->inode, true);
+}
+
+/* Finds the first range of data in FILE at or after byte OFFSET,
+ * skipping holes, and stores its start and length in *START and
+ * *LENGTH.  Returns false if the rest of FILE is a hole. */
+bool
+file_allocated_range (struct file *file, off_t offset,
+		off_t *start, off_t *length) {
+	ASSERT (file != NULL);
+	return inode_allocated_range (file->inode, offset, start, length);
+}
+
+/* Reserves disk space for the LENGTH bytes of FILE starting at
+ * OFFSET, without writing it, so that later writes there do not
+ * allocate.  The range reads as zeros until written.  Extends
+ * FILE if it is shorter.  Returns false if the disk is full or
+ * FILE cannot hold reserved space. */
+bool
+file_preallocate (struct file *file, off_t offset, off_t length) {
+	ASSERT (file != NULL);
+	return inode_preallocate (file->inode, offset, length);
+}
@@ -2,10 +2,12 @@
 #include <debug.h>
 #include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
 #include "filesys/file.h"
 #include "filesys/free-map.h"
 #include "filesys/inode.h"
 #include "filesys/directory.h"
+#include "filesys/tmpfs.h"
 #include "devices/disk.h"
 
 /* The disk that contains the file system. */
@@ -23,7 +25,9 @@ filesys_init (bool format) {
 	if (filesys_disk == NULL)
 		PANIC ("hd0:1 (hdb) not present, file system initialization failed");
 
+	cache_init ();
 	inode_init ();
+	tmpfs_init ();
 	lock_init (&filesys_lock);
 
 #ifdef EFILESYS
@@ -48,12 +52,60 @@ filesys_init (bool format) {
  * to disk. */
 void
 filesys_done (void) {
+	inode_flush_all ();
+
 	/* Original FS */
 #ifdef EFILESYS
 	fat_close ();
 #else
 	free_map_close ();
 #endif
+
+	cache_done ();
+}
+
+/* Forces every open file, then everything else the buffer cache
+ * holds, to disk. */
+void
+filesys_sync (void) {
+	inode_sync_all ();
+	cache_flush ();
+}
+
+/* Opens the root directory of the file system that holds the file
+ * named NAME, and stores in *BASE the name to look up there.
+ * Names that begin with "/tmp/" are in tmpfs, mounted there. */
+static struct dir *
+open_root (const char *name, const char **base) {
+	static const char mount[] = "/" TMPFS_MOUNT "/";
+
+	if (strlen (name) >= sizeof mount - 1
+			&& !memcmp (name, mount, sizeof mount - 1)) {
+		*base = name + sizeof mount - 1;
+		return dir_open (inode_open (TMPFS_ROOT_INUMBER));
+	}
+	*base = name;
+	return dir_open_root ();
+}
+
+/* Picks an inode number for a new file in DIR, a disk sector or a
+ * tmpfs number depending on which file system DIR is in, and
+ * stores it in *INUMBER. */
+static bool
+allocate_inumber (struct dir *dir, disk_sector_t *inumber) {
+	if (tmpfs_owns (inode_get_inumber (dir_get_inode (dir))))
+		return tmpfs_allocate (inumber);
+	return free_map_allocate (1, inumber);
+}
+
+/* Gives back INUMBER, and its inode if one was created, after a
+ * file creation fails. */
+static void
+release_inumber (disk_sector_t inumber) {
+	if (tmpfs_owns (inumber))
+		tmpfs_remove (inumber);
+	else
+		free_map_release (inumber, 1);
 }
 
 /* Creates a file named NAME with the given INITIAL_SIZE.
@@ -63,13 +115,55 @@ filesys_done (void) {
 bool
 filesys_create (const char *name, off_t initial_size) {
 	disk_sector_t inode_sector = 0;
-	struct dir *dir = dir_open_root ();
+	const char *base;
+	struct dir *dir = open_root (name, &base);
 	bool success = (dir != NULL
-			&& free_map_allocate (1, &inode_sector)
+			&& allocate_inumber (dir, &inode_sector)
 			&& inode_create (inode_sector, initial_size)
-			&& dir_add (dir, name, inode_sector));
+			&& dir_add (dir, base, inode_sector));
 	if (!success && inode_sector != 0)
-		free_map_release (inode_sector, 1);
+		release_inumber (inode_sector);
+	dir_close (dir);
+
+	return success;
+}
+
+/* Creates a file named NEW_NAME holding the same data as the file
+ * named NAME, sharing its disk sectors rather than copying them.
+ * Returns true if successful, false otherwise.
+ * Fails if no file named NAME exists, if a file named NEW_NAME
+ * already exists, or if the disk is full. */
+bool
+filesys_clone (const char *name, const char *new_name) {
+	disk_sector_t inode_sector = 0;
+	const char *base, *new_base;
+	struct dir *dir = open_root (name, &base);
+	struct dir *new_dir = open_root (new_name, &new_base);
+	struct inode *inode = NULL;
+	bool success = false;
+
+	/* Both names must be on disk. */
+	if (dir != NULL && new_dir != NULL
+			&& !tmpfs_owns (inode_get_inumber (dir_get_inode (dir)))
+			&& !tmpfs_owns (inode_get_inumber (dir_get_inode (new_dir)))
+			&& dir_lookup (dir, base, &inode)
+			&& free_map_allocate (1, &inode_sector)) {
+		if (!inode_clone (inode, inode_sector))
+			free_map_release (inode_sector, 1);
+		else if (dir_add (new_dir, new_base, inode_sector))
+			success = true;
+		else {
+			/* Removing the nameless clone gives back its sector and
+			 * its claim on the shared data. */
+			struct inode *clone = inode_open (inode_sector);
+			if (clone != NULL) {
+				inode_remove (clone);
+				inode_close (clone);
+			}
+		}
+	}
+	inode_close (inode);
+	dir_close (new_dir);
 	dir_close (dir);
 
 	return success;
@@ -82,11 +176,12 @@ filesys_create (const char *name, off_t initial_size) {
  * or if an internal memory allocation fails. */
 struct file *
 filesys_open (const char *name) {
-	struct dir *dir = dir_open_root ();
+	const char *base;
+	struct dir *dir = open_root (name, &base);
 	struct inode *inode = NULL;
 
 	if (dir != NULL)
-		dir_lookup (dir, name, &inode);
+		dir_lookup (dir, base, &inode);
 	dir_close (dir);
 
 	return file_open (inode);
@@ -98,13 +193,105 @@ filesys_open (const char *name) {
  * or if an internal memory allocation fails. */
 bool
 filesys_remove (const char *name) {
-	struct dir *dir = dir_open_root ();
-	bool success = dir != NULL && dir_remove (dir, name);
+	const char *base;
+	struct dir *dir = open_root (name, &base);
+	bool success = dir != NULL && dir_remove (dir, base);
 	dir_close (dir);
 
 	return success;
 }
 
+/* Stores up to CNT entries of the directory named DIR, which is
+ * "/" or the tmpfs mount point "/tmp", in ENTS, starting at byte
+ * offset *POS of the directory, and advances *POS past them.
+ * Returns the number of entries stored, which is 0 at the end of
+ * the directory, or -1 if there is no directory named DIR. */
+int
+filesys_getdents (const char *dir_name, off_t *pos, struct dirent *ents,
+		size_t cnt) {
+	struct dir *dir;
+	int n;
+
+	if (!strcmp (dir_name, "/"))
+		dir = dir_open_root ();
+	else if (!strcmp (dir_name, "/" TMPFS_MOUNT)
+			|| !strcmp (dir_name, "/" TMPFS_MOUNT "/"))
+		dir = dir_open (inode_open (TMPFS_ROOT_INUMBER));
+	else
+		return -1;
+	if (dir == NULL)
+		return -1;
+
+	n = dir_getdents (dir, pos, ents, cnt);
+	dir_close (dir);
+
+	return n;
+}
+
+#ifndef EFILESYS
+/* Adds INODE to the statistics in *STATS, after moving its data
+ * together with inode_defrag() if DEFRAG is true.
+ * Returns true if its data moved. */
+static bool
+scan_file (struct inode *inode, struct frag_stats *stats, bool defrag) {
+	bool moved = defrag && inode_defrag (inode);
+
+	stats->file_cnt++;
+	stats->extent_cnt += inode_extent_cnt (inode);
+	return moved;
+}
+
+/* Gathers fragmentation statistics for the disk into *STATS,
+ * defragmenting the root directory and each file in it along the
+ * way, before counting its extents, if DEFRAG is true.
+ * Returns the number of files whose data moved. */
+static int
+scan_files (struct frag_stats *stats, bool defrag) {
+	struct dir *dir = dir_open_root ();
+	char name[NAME_MAX + 1];
+	size_t free_cnt, run_cnt, run_max;
+	int moved = 0;
+
+	memset (stats, 0, sizeof *stats);
+	if (dir != NULL) {
+		moved += scan_file (dir_get_inode (dir), stats, defrag);
+		while (dir_readdir (dir, name)) {
+			struct inode *inode;
+			if (dir_lookup (dir, name, &inode)) {
+				moved += scan_file (inode, stats, defrag);
+				inode_close (inode);
+			}
+		}
+		dir_close (dir);
+	}
+
+	free_map_stats (&free_cnt, &run_cnt, &run_max);
+	stats->free_cnt = free_cnt;
+	stats->free_run_cnt = run_cnt;
+	stats->free_run_max = run_max;
+	return moved;
+}
+#endif
+
+/* Moves the data of each file on disk into one contiguous run, if
+ * it is in pieces and a free run is long enough, so that it reads
+ * sequentially and free space coalesces.  Files stay usable
+ * throughout.  Stores the fragmentation beforehand in *BEFORE and
+ * afterward in *AFTER.
+ * Returns the number of files whose data moved, or -1 if the file
+ * system cannot be defragmented. */
+int
+filesys_defrag (struct frag_stats *before, struct frag_stats *after) {
+#ifdef EFILESYS
+	memset (before, 0, sizeof *before);
+	memset (after, 0, sizeof *after);
+	return -1;
+#else
+	scan_files (before, false);
+	return scan_files (after, true);
+#endif
+}
+
 /* Formats the file system. */
 static void
 do_format (void) {
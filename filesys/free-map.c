@@ -1,47 +1,221 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <stdint.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
+#include "threads/malloc.h"
+#include "threads/synch.h"
 
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per disk sector. */
 
+/* Sectors may be shared by several files, after a clone.  The
+ * refcount map counts each sector's owners beyond the first, so
+ * that it is freed only when its last owner releases it. */
+static struct file *refcount_file;   /* Refcount map file. */
+static uint8_t *refcounts;           /* Refcount map, one byte per sector. */
+
+/* Protects the free map and the refcount map.  Sectors are
+ * allocated and released from the write path, under nothing but
+ * the inode's own lock, so two files may do so at once. */
+static struct lock free_map_lock;
+
+/* Data written to a hole may wait in the buffer cache before
+ * sectors are picked for it.  Each such sector is reserved when
+ * the data is written, so that the write fails if the disk is
+ * full, rather than the write-back later.  Ordinary allocations
+ * leave RESERVED_CNT of the FREE_CNT free sectors alone. */
+static size_t free_cnt;              /* Number of free sectors. */
+static size_t reserved_cnt;          /* Number of those reserved. */
+
 /* Initializes the free map. */
 void
 free_map_init (void) {
+	lock_init (&free_map_lock);
 	free_map = bitmap_create (disk_size (filesys_disk));
 	if (free_map == NULL)
 		PANIC ("bitmap creation failed--disk is too large");
 	bitmap_mark (free_map, FREE_MAP_SECTOR);
 	bitmap_mark (free_map, ROOT_DIR_SECTOR);
+	bitmap_mark (free_map, REFCOUNT_MAP_SECTOR);
+	free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+
+	refcounts = calloc (1, disk_size (filesys_disk));
+	if (refcounts == NULL)
+		PANIC ("refcount map creation failed--disk is too large");
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
- * the first into *SECTORP.
- * Returns true if successful, false if all sectors were
- * available. */
-bool
-free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
-	disk_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
-	if (sector != BITMAP_ERROR
-			&& free_map_file != NULL
-			&& !bitmap_write (free_map, free_map_file)) {
-		bitmap_set_multiple (free_map, sector, cnt, false);
-		sector = BITMAP_ERROR;
+ * the first into *SECTORP, taking them from the reserved sectors
+ * if RESERVED is true or leaving those alone otherwise.
+ * Returns true if successful, false if not enough consecutive
+ * sectors were available. */
+static bool
+allocate (size_t cnt, disk_sector_t *sectorp, bool reserved) {
+	disk_sector_t sector = BITMAP_ERROR;
+
+	lock_acquire (&free_map_lock);
+	ASSERT (!reserved || cnt <= reserved_cnt);
+	if (reserved || free_cnt - reserved_cnt >= cnt) {
+		sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+		if (sector != BITMAP_ERROR
+				&& free_map_file != NULL
+				&& !bitmap_write (free_map, free_map_file)) {
+			bitmap_set_multiple (free_map, sector, cnt, false);
+			sector = BITMAP_ERROR;
+		}
+	}
+	if (sector != BITMAP_ERROR) {
+		free_cnt -= cnt;
+		if (reserved)
+			reserved_cnt -= cnt;
 	}
+	lock_release (&free_map_lock);
+
 	if (sector != BITMAP_ERROR)
 		*sectorp = sector;
 	return sector != BITMAP_ERROR;
 }
 
-/* Makes CNT sectors starting at SECTOR available for use. */
+/* Allocates CNT consecutive sectors from the free map and stores
+ * the first into *SECTORP.
+ * Returns true if successful, false if not enough consecutive
+ * sectors were available. */
+bool
+free_map_allocate (size_t cnt, disk_sector_t *sectorp) {
+	return allocate (cnt, sectorp, false);
+}
+
+/* Like free_map_allocate(), but takes the CNT sectors out of
+ * those set aside by free_map_reserve(), so that they are not
+ * kept from it by reservations, its own included.  Fails only if
+ * free space is too fragmented for a run of CNT. */
+bool
+free_map_allocate_reserved (size_t cnt, disk_sector_t *sectorp) {
+	return allocate (cnt, sectorp, true);
+}
+
+/* Sets aside CNT free sectors, without picking which, for later
+ * allocation by free_map_allocate_reserved().
+ * Returns false if fewer than CNT sectors are free and not already
+ * reserved. */
+bool
+free_map_reserve (size_t cnt) {
+	bool success;
+
+	lock_acquire (&free_map_lock);
+	success = free_cnt - reserved_cnt >= cnt;
+	if (success)
+		reserved_cnt += cnt;
+	lock_release (&free_map_lock);
+	return success;
+}
+
+/* Gives up CNT sectors set aside by free_map_reserve() but never
+ * allocated. */
+void
+free_map_unreserve (size_t cnt) {
+	lock_acquire (&free_map_lock);
+	ASSERT (cnt <= reserved_cnt);
+	reserved_cnt -= cnt;
+	lock_release (&free_map_lock);
+}
+
+/* Writes the refcounts of the CNT sectors starting at SECTOR to
+ * disk. */
+static void
+write_refcounts (disk_sector_t sector, size_t cnt) {
+	if (refcount_file != NULL)
+		file_write_at (refcount_file, refcounts + sector, cnt, sector);
+}
+
+/* Releases one owner's claim on each of CNT sectors starting at
+ * SECTOR, making those that had no other owner available for
+ * use. */
 void
 free_map_release (disk_sector_t sector, size_t cnt) {
+	bool shared = false;
+	size_t i;
+
+	lock_acquire (&free_map_lock);
 	ASSERT (bitmap_all (free_map, sector, cnt));
-	bitmap_set_multiple (free_map, sector, cnt, false);
+	for (i = 0; i < cnt; i++)
+		if (refcounts[sector + i] > 0) {
+			refcounts[sector + i]--;
+			shared = true;
+		} else {
+			bitmap_reset (free_map, sector + i);
+			free_cnt++;
+		}
+	if (shared)
+		write_refcounts (sector, cnt);
 	bitmap_write (free_map, free_map_file);
+	lock_release (&free_map_lock);
+}
+
+/* Adds an owner to each of the CNT allocated sectors starting at
+ * SECTOR, which must each be released once more before they are
+ * free.
+ * Returns false, changing nothing, if one of them already has as
+ * many owners as can be counted. */
+bool
+free_map_share (disk_sector_t sector, size_t cnt) {
+	bool success = true;
+	size_t i;
+
+	lock_acquire (&free_map_lock);
+	ASSERT (bitmap_all (free_map, sector, cnt));
+	for (i = 0; i < cnt; i++)
+		if (refcounts[sector + i] == UINT8_MAX)
+			success = false;
+	if (success) {
+		for (i = 0; i < cnt; i++)
+			refcounts[sector + i]++;
+		write_refcounts (sector, cnt);
+	}
+	lock_release (&free_map_lock);
+	return success;
+}
+
+/* Returns true if any of the CNT sectors starting at SECTOR has
+ * more than one owner. */
+bool
+free_map_is_shared (disk_sector_t sector, size_t cnt) {
+	bool shared = false;
+	size_t i;
+
+	lock_acquire (&free_map_lock);
+	for (i = 0; i < cnt && !shared; i++)
+		if (refcounts[sector + i] > 0)
+			shared = true;
+	lock_release (&free_map_lock);
+	return shared;
+}
+
+/* Stores in *FREE_CNT the number of free sectors, in *RUN_CNT the
+ * number of runs of consecutive free sectors they form, and in
+ * *RUN_MAX the length of the longest run. */
+void
+free_map_stats (size_t *free_cnt, size_t *run_cnt, size_t *run_max) {
+	size_t size = bitmap_size (free_map);
+	size_t start = 0;
+
+	*free_cnt = *run_cnt = *run_max = 0;
+	lock_acquire (&free_map_lock);
+	while ((start = bitmap_scan (free_map, start, 1, false)) != BITMAP_ERROR) {
+		size_t end = bitmap_scan (free_map, start, 1, true);
+		if (end == BITMAP_ERROR)
+			end = size;
+
+		*free_cnt += end - start;
+		(*run_cnt)++;
+		if (end - start > *run_max)
+			*run_max = end - start;
+		start = end;
+	}
+	lock_release (&free_map_lock);
 }
 
 /* Opens the free map file and reads it from disk. */
@@ -52,20 +226,39 @@ free_map_open (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_read (free_map, free_map_file))
 		PANIC ("can't read free map");
+	free_cnt = bitmap_count (free_map, 0, bitmap_size (free_map), false);
+
+	refcount_file = file_open (inode_open (REFCOUNT_MAP_SECTOR));
+	if (refcount_file == NULL)
+		PANIC ("can't open refcount map");
+	if (file_read_at (refcount_file, refcounts, disk_size (filesys_disk), 0)
+			!= (off_t) disk_size (filesys_disk))
+		PANIC ("can't read refcount map");
 }
 
 /* Writes the free map to disk and closes the free map file. */
 void
 free_map_close (void) {
+	file_close (refcount_file);
 	file_close (free_map_file);
 }
 
+/* Forces the free map to disk. */
+void
+free_map_sync (void) {
+	if (refcount_file != NULL)
+		file_sync (refcount_file);
+	if (free_map_file != NULL)
+		file_sync (free_map_file);
+}
+
 /* Creates a new free map file on disk and writes the free map to
  * it. */
 void
 free_map_create (void) {
 	/* Create inode. */
-	if (!inode_create (FREE_MAP_SECTOR, bitmap_file_size (free_map)))
+	if (!inode_create_allocated (FREE_MAP_SECTOR,
+				bitmap_file_size (free_map)))
 		PANIC ("free map creation failed");
 
 	/* Write bitmap to file. */
@@ -74,4 +267,13 @@ free_map_create (void) {
 		PANIC ("can't open free map");
 	if (!bitmap_write (free_map, free_map_file))
 		PANIC ("can't write free map");
+
+	/* The refcount map starts out all zeros, which is how
+	 * inode_create_allocated() leaves it. */
+	if (!inode_create_allocated (REFCOUNT_MAP_SECTOR,
+				disk_size (filesys_disk)))
+		PANIC ("refcount map creation failed");
+	refcount_file = file_open (inode_open (REFCOUNT_MAP_SECTOR));
+	if (refcount_file == NULL)
+		PANIC ("can't open refcount map");
 }
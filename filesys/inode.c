@@ -2,21 +2,93 @@
 #include <list.h>
 #include <debug.h>
 #include <round.h>
+#include <stdio.h>
 #include <string.h>
+#include "filesys/cache.h"
+#include "filesys/compress.h"
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
+#include "filesys/tmpfs.h"
 #include "threads/malloc.h"
+#include "threads/synch.h"
 
 /* Identifies an inode. */
 #define INODE_MAGIC 0x494e4f44
 
+/* Number of extents that fit in an on-disk inode.  There is no
+ * indirect extent block.  When a write needs an extent and the
+ * table is full, the file's data moves into one contiguous run,
+ * merging its extents (see make_extent_room()).  So a file is
+ * limited to this many separate stretches of data, holes, and
+ * preallocated space, and to the longest run of free sectors once
+ * it has needed this many extents.  A write past either limit
+ * comes back short. */
+#define INODE_EXTENT_CNT 40
+
+/* Number of sectors an inode may keep in delayed buffers before
+ * disk sectors are picked for them. */
+#define INODE_DELAYED_MAX 16
+
+/* A run of consecutive file sectors stored in consecutive disk
+ * sectors. */
+struct extent {
+	uint32_t idx;                       /* First file sector. */
+	disk_sector_t start;                /* First disk sector. */
+	uint32_t length;                    /* Number of sectors. */
+};
+
+/* Largest file whose data is stored in the inode sector itself,
+ * in place of the extent table. */
+#define INODE_INLINE_MAX (INODE_EXTENT_CNT * sizeof (struct extent))
+
+/* A compressed file is stored in chunks of CHUNK_SECTORS sectors,
+ * each compressed on its own into as few sectors as it needs. */
+#define CHUNK_SECTORS 32
+#define CHUNK_SIZE (CHUNK_SECTORS * DISK_SECTOR_SIZE)
+
+/* Where a chunk of a compressed file is stored. */
+struct chunk {
+	disk_sector_t start;                /* First disk sector. */
+	uint16_t sector_cnt;                /* Sectors used, 0 if a hole. */
+	uint16_t size;                      /* Compressed bytes, 0 if raw. */
+};
+
+/* Number of chunks, and so the size limit, of a compressed file. */
+#define INODE_CHUNK_CNT (INODE_INLINE_MAX / sizeof (struct chunk))
+#define INODE_COMPRESSED_MAX ((off_t) (INODE_CHUNK_CNT * CHUNK_SIZE))
+
+/* Inode flags. */
+#define INODE_INLINE 0x1                /* Data is in INLINE_DATA. */
+#define INODE_COMPRESSED 0x2            /* Data is in CHUNKS. */
+
 /* On-disk inode.
- * Must be exactly DISK_SECTOR_SIZE bytes long. */
+ * Must be exactly DISK_SECTOR_SIZE bytes long.
+ *
+ * A file no longer than INODE_INLINE_MAX bytes keeps its data in
+ * the inode, so that it takes no data sectors and is read along
+ * with the inode.  It moves out to a data sector the first time
+ * it grows past that.  An inline inode has no extents, and the
+ * bytes of INLINE_DATA past the end of file are zeros.
+ *
+ * A compressed file has no extents either.  CHUNKS locates each of
+ * its chunks instead.
+ *
+ * An unwritten extent holds disk sectors reserved ahead of time by
+ * inode_preallocate() that have never been written.  It reads as
+ * zeros, like a hole, and each sector turns into ordinary data the
+ * first time it is written. */
 struct inode_disk {
-	disk_sector_t start;                /* First data sector. */
 	off_t length;                       /* File size in bytes. */
 	unsigned magic;                     /* Magic number. */
-	uint32_t unused[125];               /* Not used. */
+	uint32_t extent_cnt;                /* Number of extents in use. */
+	union {
+		struct extent extents[INODE_EXTENT_CNT]; /* Sorted by file sector. */
+		uint8_t inline_data[INODE_INLINE_MAX];   /* With INODE_INLINE. */
+		struct chunk chunks[INODE_CHUNK_CNT];    /* With INODE_COMPRESSED. */
+	};
+	uint32_t flags;                     /* INODE_* flags. */
+	uint64_t unwritten;                 /* Bit I set if extent I is unwritten. */
+	uint32_t unused[2];                 /* Not used. */
 };
 
 /* Returns the number of sectors to allocate for an inode SIZE
@@ -26,69 +98,1016 @@ bytes_to_sectors (off_t size) {
 	return DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
 }
 
-/* In-memory inode. */
+/* In-memory inode.
+ *
+ * Files are sparse: a file sector that no extent covers is a hole,
+ * which reads as zeros and takes no disk space.  The first write
+ * to a hole does not allocate either.  It puts the data in a
+ * delayed buffer in the buffer cache, and disk sectors are picked
+ * for all of an inode's delayed buffers at once, as one run, when
+ * there are INODE_DELAYED_MAX of them or when the inode is written
+ * back.
+ *
+ * A compressed file is read and written through one chunk at a
+ * time, held uncompressed in CHUNK, which is compressed and
+ * written back when another chunk is needed or the inode is.
+ *
+ * An inode numbered for tmpfs has no sector at all.  MEM holds
+ * its data, and DATA is unused.
+ *
+ * Reads and writes look up each data sector under LOCK but move
+ * the data without it.  IO_CNT counts those transfers, so that
+ * inode_defrag() can wait for them before it moves the data. */
 struct inode {
 	struct list_elem elem;              /* Element in inode list. */
 	disk_sector_t sector;               /* Sector number of disk location. */
 	int open_cnt;                       /* Number of openers. */
 	bool removed;                       /* True if deleted, false otherwise. */
 	int deny_write_cnt;                 /* 0: writes ok, >0: deny writes. */
+	struct lock lock;                   /* Protects DATA and DELAYED. */
+	int io_cnt;                         /* Transfers in progress. */
+	struct condition io_done;           /* Signaled when IO_CNT drops to 0. */
+	bool dirty;                         /* DATA changed since last writeback? */
+	size_t delayed_cnt;                 /* Number of delayed sectors. */
+	disk_sector_t delayed[INODE_DELAYED_MAX]; /* Delayed sectors, sorted. */
+	uint8_t *chunk;                     /* Current chunk's data, or NULL. */
+	uint8_t *scratch;                   /* Space to compress CHUNK. */
+	disk_sector_t chunk_idx;            /* Current chunk, or -1. */
+	bool chunk_dirty;                   /* CHUNK changed since loaded? */
+	struct tmpfs_node *mem;             /* tmpfs inode, or NULL if on disk. */
 	struct inode_disk data;             /* Inode content. */
 };
 
+/* Returns the extent of DISK_INODE that covers file sector IDX,
+ * or a null pointer if IDX is in a hole. */
+static struct extent *
+find_extent (const struct inode_disk *disk_inode, disk_sector_t idx) {
+	uint32_t i;
+
+	for (i = 0; i < disk_inode->extent_cnt; i++) {
+		const struct extent *e = &disk_inode->extents[i];
+		if (idx < e->idx)
+			break;
+		if (idx < e->idx + e->length)
+			return (struct extent *) e;
+	}
+	return NULL;
+}
+
+/* Returns true if extent I of DISK_INODE is unwritten. */
+static bool
+is_unwritten (const struct inode_disk *disk_inode, uint32_t i) {
+	return (disk_inode->unwritten >> i) & 1;
+}
+
+/* Returns true if file sector IDX of DISK_INODE is in an unwritten
+ * extent. */
+static bool
+sector_unwritten (const struct inode_disk *disk_inode, disk_sector_t idx) {
+	const struct extent *e = find_extent (disk_inode, idx);
+	return e != NULL && is_unwritten (disk_inode, e - disk_inode->extents);
+}
+
+/* Makes room for a new extent at index I of DISK_INODE's extent
+ * table, which must not be full, and marks it unwritten if
+ * UNWRITTEN is true.  Returns the new extent, whose other members
+ * the caller fills in. */
+static struct extent *
+insert_extent (struct inode_disk *disk_inode, uint32_t i, bool unwritten) {
+	uint64_t below = (1ULL << i) - 1;
+	uint64_t bits = disk_inode->unwritten;
+
+	ASSERT (disk_inode->extent_cnt < INODE_EXTENT_CNT);
+	ASSERT (i <= disk_inode->extent_cnt);
+
+	memmove (&disk_inode->extents[i + 1], &disk_inode->extents[i],
+			(disk_inode->extent_cnt - i) * sizeof *disk_inode->extents);
+	disk_inode->unwritten = (bits & below) | ((bits & ~below) << 1)
+		| ((uint64_t) unwritten << i);
+	disk_inode->extent_cnt++;
+	return &disk_inode->extents[i];
+}
+
+/* Removes extent I from DISK_INODE's extent table. */
+static void
+delete_extent (struct inode_disk *disk_inode, uint32_t i) {
+	uint64_t below = (1ULL << i) - 1;
+	uint64_t bits = disk_inode->unwritten;
+
+	ASSERT (i < disk_inode->extent_cnt);
+
+	memmove (&disk_inode->extents[i], &disk_inode->extents[i + 1],
+			(disk_inode->extent_cnt - i - 1) * sizeof *disk_inode->extents);
+	disk_inode->unwritten = (bits & below) | ((bits >> 1) & ~below);
+	disk_inode->extent_cnt--;
+}
+
+/* Returns the number of runs of data sectors in DISK_INODE, each
+ * an extent or, in a compressed file, a chunk. */
+static size_t
+data_run_cnt (const struct inode_disk *disk_inode) {
+	return (disk_inode->flags & INODE_COMPRESSED ? INODE_CHUNK_CNT
+			: disk_inode->extent_cnt);
+}
+
+/* Stores in *START the first disk sector of run I of DISK_INODE's
+ * data sectors and returns its length in sectors, 0 for a hole. */
+static size_t
+data_run (const struct inode_disk *disk_inode, size_t i,
+		disk_sector_t *start) {
+	if (disk_inode->flags & INODE_COMPRESSED) {
+		*start = disk_inode->chunks[i].start;
+		return disk_inode->chunks[i].sector_cnt;
+	}
+	*start = disk_inode->extents[i].start;
+	return disk_inode->extents[i].length;
+}
+
 /* Returns the disk sector that contains byte offset POS within
  * INODE.
  * Returns -1 if INODE does not contain data for a byte at offset
- * POS. */
+ * POS, that is, if POS is past end of file, in a hole, in an
+ * unwritten extent, or in a delayed buffer. */
 static disk_sector_t
 byte_to_sector (const struct inode *inode, off_t pos) {
 	ASSERT (inode != NULL);
-	if (pos < inode->data.length)
-		return inode->data.start + pos / DISK_SECTOR_SIZE;
-	else
+	if (pos < inode->data.length) {
+		disk_sector_t idx = pos / DISK_SECTOR_SIZE;
+		const struct extent *e = find_extent (&inode->data, idx);
+		if (e != NULL && !is_unwritten (&inode->data, e - inode->data.extents))
+			return e->start + (idx - e->idx);
+	}
+	return -1;
+}
+
+/* Returns the disk sector that holds the file sector of INODE
+ * beginning at byte OFFSET, and stores in *CNT how many sectors,
+ * up to MAX, run contiguously on disk from there and lie wholly
+ * within the file.
+ * Returns -1 if that sector is a hole, unwritten, delayed, or not
+ * wholly within the file. */
+static disk_sector_t
+sector_run (const struct inode *inode, off_t offset, size_t max,
+		size_t *cnt) {
+	disk_sector_t idx = offset / DISK_SECTOR_SIZE;
+	const struct extent *e;
+	size_t in_file;
+
+	ASSERT (offset % DISK_SECTOR_SIZE == 0);
+
+	if (offset + DISK_SECTOR_SIZE > inode->data.length)
 		return -1;
+	e = find_extent (&inode->data, idx);
+	if (e == NULL || is_unwritten (&inode->data, e - inode->data.extents))
+		return -1;
+
+	in_file = (inode->data.length - offset) / DISK_SECTOR_SIZE;
+	*cnt = e->idx + e->length - idx;
+	if (*cnt > in_file)
+		*cnt = in_file;
+	if (*cnt > max)
+		*cnt = max;
+	return e->start + (idx - e->idx);
+}
+
+/* Returns true if INODE is the free map or the refcount map.
+ * The free map writes them with its lock held, and they are never
+ * cloned, so writes to them need not ask whether a sector is
+ * shared. */
+static bool
+is_free_map (const struct inode *inode) {
+	return inode->sector == FREE_MAP_SECTOR
+		|| inode->sector == REFCOUNT_MAP_SECTOR;
+}
+
+/* Returns true if file sector IDX of INODE is in a delayed
+ * buffer. */
+static bool
+is_delayed (const struct inode *inode, disk_sector_t idx) {
+	size_t i;
+
+	for (i = 0; i < inode->delayed_cnt; i++)
+		if (inode->delayed[i] == idx)
+			return true;
+	return false;
+}
+
+/* Counts a transfer to or from a data sector of INODE, which
+ * the caller just looked up, as in progress until end_io(). */
+static void
+begin_io (struct inode *inode) {
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+	inode->io_cnt++;
+}
+
+/* Ends a transfer counted by begin_io(). */
+static void
+end_io (struct inode *inode) {
+	lock_acquire (&inode->lock);
+	if (--inode->io_cnt == 0)
+		cond_broadcast (&inode->io_done, &inode->lock);
+	lock_release (&inode->lock);
+}
+
+/* Number of sectors moved by one direct I/O request. */
+#define DIRECT_MAX 64
+
+/* Moves CNT sectors between BUFFER and the file system disk,
+ * starting at SECTOR, with as few requests as possible. */
+static void
+direct_transfer (disk_sector_t sector, uint8_t *buffer, size_t cnt,
+		bool write) {
+	while (cnt > 0) {
+		size_t chunk = cnt < DIRECT_MAX ? cnt : DIRECT_MAX;
+		struct disk_request r;
+
+		disk_request_init (&r, filesys_disk, write, DISK_FILESYS, sector,
+				buffer, chunk);
+		disk_submit (&r);
+		disk_wait (&r);
+
+		sector += chunk;
+		buffer += chunk * DISK_SECTOR_SIZE;
+		cnt -= chunk;
+	}
+}
+
+/* Records in DISK_INODE that file sector IDX, which was a hole, is
+ * stored in disk sector SECTOR.  Extends a neighbouring extent
+ * when the sector is contiguous with it on disk.
+ * Returns false if a new extent is needed but the table is
+ * full. */
+static bool
+map_sector (struct inode_disk *disk_inode, disk_sector_t idx,
+		disk_sector_t sector) {
+	struct extent *extents = disk_inode->extents;
+	uint32_t cnt = disk_inode->extent_cnt;
+	struct extent *e;
+	uint32_t i;
+
+	/* Find the first extent after IDX. */
+	for (i = 0; i < cnt; i++)
+		if (extents[i].idx > idx)
+			break;
+
+	if (i > 0 && !is_unwritten (disk_inode, i - 1)) {
+		struct extent *prev = &extents[i - 1];
+		if (prev->idx + prev->length == idx
+				&& prev->start + prev->length == sector) {
+			prev->length++;
+
+			/* The sector may also close the gap to the next extent. */
+			if (i < cnt && extents[i].idx == idx + 1
+					&& extents[i].start == sector + 1
+					&& !is_unwritten (disk_inode, i)) {
+				prev->length += extents[i].length;
+				delete_extent (disk_inode, i);
+			}
+			return true;
+		}
+	}
+	if (i < cnt && extents[i].idx == idx + 1
+			&& extents[i].start == sector + 1
+			&& !is_unwritten (disk_inode, i)) {
+		extents[i].idx--;
+		extents[i].start--;
+		extents[i].length++;
+		return true;
+	}
+
+	if (cnt == INODE_EXTENT_CNT)
+		return false;
+	e = insert_extent (disk_inode, i, false);
+	e->idx = idx;
+	e->start = sector;
+	e->length = 1;
+	return true;
+}
+
+/* Removes file sector IDX, which must be mapped, from its extent
+ * in DISK_INODE, splitting the extent in two if IDX is in its
+ * middle.
+ * Returns false if a new extent is needed but the table is
+ * full. */
+static bool
+unmap_sector (struct inode_disk *disk_inode, disk_sector_t idx) {
+	struct extent *extents = disk_inode->extents;
+	struct extent *e = find_extent (disk_inode, idx);
+	uint32_t i;
+
+	ASSERT (e != NULL);
+	i = e - extents;
+
+	if (idx == e->idx) {
+		e->idx++;
+		e->start++;
+		if (--e->length == 0)
+			delete_extent (disk_inode, i);
+	} else if (idx == e->idx + e->length - 1)
+		e->length--;
+	else {
+		uint32_t skip = idx + 1 - e->idx;
+
+		if (disk_inode->extent_cnt == INODE_EXTENT_CNT)
+			return false;
+		insert_extent (disk_inode, i, is_unwritten (disk_inode, i));
+		e[0] = e[1];
+		e[0].length = idx - e->idx;
+		e[1].idx += skip;
+		e[1].start += skip;
+		e[1].length -= skip;
+	}
+	return true;
+}
+
+/* Picks disk sectors for all of INODE's delayed buffers, as one
+ * contiguous run if the free map has one, and hands the buffers
+ * to the cache as ordinary dirty sectors.
+ *
+ * This cannot fail.  Each delayed buffer had a disk sector
+ * reserved for it when it was made, and the extent table is kept
+ * with room for each to need an extent of its own. */
+static void
+allocate_delayed (struct inode *inode) {
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	while (inode->delayed_cnt > 0) {
+		size_t cnt = inode->delayed_cnt;
+		disk_sector_t start;
+		size_t i;
+
+		/* Settle for shorter runs if free space is fragmented. */
+		while (!free_map_allocate_reserved (cnt, &start)) {
+			cnt /= 2;
+			ASSERT (cnt > 0);
+		}
+
+		/* The run goes to the first CNT delayed sectors, in file
+		 * order, so that sequential data lands contiguously. */
+		for (i = 0; i < cnt; i++) {
+			if (!map_sector (&inode->data, inode->delayed[i], start + i))
+				PANIC ("no extent for delayed sector");
+			cache_assign_delayed (inode, inode->delayed[i], start + i);
+		}
+		inode->delayed_cnt -= cnt;
+		memmove (inode->delayed, inode->delayed + cnt,
+				inode->delayed_cnt * sizeof *inode->delayed);
+		inode->dirty = true;
+	}
+}
+
+/* Drops INODE's delayed buffers, along with the disk sectors
+ * reserved for them. */
+static void
+discard_delayed (struct inode *inode) {
+	cache_discard_delayed (inode);
+	free_map_unreserve (inode->delayed_cnt);
+	inode->delayed_cnt = 0;
+}
+
+/* Moves the data of INODE, which must not be in tmpfs or be the
+ * free or refcount map, into one run of consecutive free sectors,
+ * in file order, so that it reads back sequentially and its
+ * extents merge wherever the file has no hole.  The data is copied and forced to
+ * disk, then the inode is switched over to it with a single
+ * sector write, and only then are the old sectors freed, so a
+ * crash leaves one layout or the other intact.
+ * Waits first for reads and writes already under way, with the
+ * inode's lock released meanwhile.
+ * Returns true if the data moved.  Leaves alone inline and
+ * compressed inodes, data in a single extent, data shared with a
+ * clone, and data for which no free run is long enough. */
+static bool
+relocate (struct inode *inode) {
+	struct inode_disk *data = &inode->data;
+	struct extent *old = NULL;
+	disk_sector_t start, next;
+	size_t total = 0;
+	uint32_t i, old_cnt;
+	bool moved = false;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+	ASSERT (inode->mem == NULL && !is_free_map (inode));
+
+	/* Let reads and writes that already looked up the old sectors
+	 * finish with them.  No new ones can start while the lock is
+	 * held. */
+	while (inode->io_cnt > 0)
+		cond_wait (&inode->io_done, &inode->lock);
+
+	if (data->flags & (INODE_INLINE | INODE_COMPRESSED))
+		goto done;
+	allocate_delayed (inode);
+	if (data->extent_cnt < 2)
+		goto done;
+	for (i = 0; i < data->extent_cnt; i++) {
+		const struct extent *e = &data->extents[i];
+		if (free_map_is_shared (e->start, e->length))
+			goto done;
+		total += e->length;
+	}
+	old_cnt = data->extent_cnt;
+	old = malloc (old_cnt * sizeof *old);
+	if (old == NULL || !free_map_allocate (total, &start))
+		goto done;
+	memcpy (old, data->extents, old_cnt * sizeof *old);
+
+	/* Copy each extent into place.  Unwritten extents hold nothing
+	 * worth copying. */
+	next = start;
+	for (i = 0; i < old_cnt; i++) {
+		struct extent *e = &data->extents[i];
+		uint32_t k;
+
+		if (!is_unwritten (data, i))
+			for (k = 0; k < e->length; k++)
+				cache_copy (next + k, e->start + k);
+		e->start = next;
+		next += e->length;
+	}
+	cache_flush_range (start, total);
+
+	/* Extents that now adjoin on disk and in the file become one. */
+	for (i = 1; i < data->extent_cnt; )
+		if (data->extents[i - 1].idx + data->extents[i - 1].length
+				== data->extents[i].idx
+				&& is_unwritten (data, i - 1) == is_unwritten (data, i)) {
+			data->extents[i - 1].length += data->extents[i].length;
+			delete_extent (data, i);
+		} else
+			i++;
+
+	/* The new run must be marked in use on disk before the inode
+	 * points to it, and the inode must point away from the old
+	 * sectors before they can be reused. */
+	free_map_sync ();
+	cache_write (inode->sector, data, 0, DISK_SECTOR_SIZE);
+	cache_flush_range (inode->sector, 1);
+	inode->dirty = false;
+	for (i = 0; i < old_cnt; i++)
+		free_map_release (old[i].start, old[i].length);
+	moved = true;
+
+done:
+	free (old);
+	return moved;
+}
+
+/* Returns the number of extents INODE's extent table would hold
+ * after relocate(): one for each stretch of consecutive file
+ * sectors that are all written or all unwritten. */
+static size_t
+merged_extent_cnt (const struct inode *inode) {
+	const struct inode_disk *data = &inode->data;
+	size_t cnt = data->extent_cnt > 0;
+	uint32_t i;
+
+	for (i = 1; i < data->extent_cnt; i++)
+		if (data->extents[i - 1].idx + data->extents[i - 1].length
+				!= data->extents[i].idx
+				|| is_unwritten (data, i - 1) != is_unwritten (data, i))
+			cnt++;
+	return cnt;
+}
+
+/* Makes room in INODE's extent table for CNT new extents, besides
+ * the one kept for each delayed sector.  Places the delayed
+ * sectors first, and if that is not enough, moves the file's data
+ * into one run with relocate() to merge its extents.  Data that
+ * grows a sector at a time while other files grow too would
+ * otherwise take an extent per sector and fill the table quickly.
+ * Relocating may release INODE's lock for a while, so the caller
+ * must look up anything it needs only after this returns.
+ * Returns false if there is still not enough room. */
+static bool
+make_extent_room (struct inode *inode, size_t cnt) {
+	struct inode_disk *data = &inode->data;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	if (data->extent_cnt + inode->delayed_cnt + cnt <= INODE_EXTENT_CNT)
+		return true;
+	allocate_delayed (inode);
+	if (data->extent_cnt + cnt > INODE_EXTENT_CNT && !is_free_map (inode)
+			&& merged_extent_cnt (inode) + cnt <= INODE_EXTENT_CNT)
+		relocate (inode);
+	return data->extent_cnt + cnt <= INODE_EXTENT_CNT;
+}
+
+/* Gives file sector IDX of INODE, stored in disk sector OLD, which
+ * other files share, a private copy of OLD.
+ * Returns false if the disk or the extent table is full. */
+static bool
+unshare_sector (struct inode *inode, disk_sector_t idx, disk_sector_t old) {
+	disk_sector_t sector;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	/* Splitting the old extent and mapping the copy may each take
+	 * an extent.  Placing the delayed sectors first keeps them from
+	 * needing the room. */
+	if (inode->data.extent_cnt + inode->delayed_cnt + 2 > INODE_EXTENT_CNT)
+		allocate_delayed (inode);
+	if (inode->data.extent_cnt + 2 > INODE_EXTENT_CNT)
+		return false;
+	if (!free_map_allocate (1, &sector))
+		return false;
+
+	cache_copy (sector, old);
+	unmap_sector (&inode->data, idx);
+	map_sector (&inode->data, idx, sector);
+	free_map_release (old, 1);
+	inode->dirty = true;
+	return true;
+}
+
+/* Turns file sector IDX of INODE, which is in an unwritten extent,
+ * into ordinary data that reads as zeros: zeros in the cache for
+ * its reserved sector, or for a fresh one if other files share the
+ * reserved sector.
+ * Returns false if the disk or the extent table is full. */
+static bool
+write_unwritten (struct inode *inode, disk_sector_t idx) {
+	static char zeros[DISK_SECTOR_SIZE];
+	const struct extent *e = find_extent (&inode->data, idx);
+	disk_sector_t sector;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+	ASSERT (sector_unwritten (&inode->data, idx));
+
+	/* Splitting the unwritten extent and mapping the sector may
+	 * each take an extent.  Placing the delayed sectors first keeps
+	 * them from needing the room. */
+	if (inode->data.extent_cnt + inode->delayed_cnt + 2 > INODE_EXTENT_CNT)
+		allocate_delayed (inode);
+	if (inode->data.extent_cnt + 2 > INODE_EXTENT_CNT)
+		return false;
+	sector = e->start + (idx - e->idx);
+	if (free_map_is_shared (sector, 1)) {
+		disk_sector_t old = sector;
+		if (!free_map_allocate (1, &sector))
+			return false;
+		free_map_release (old, 1);
+	}
+
+	cache_write (sector, zeros, 0, DISK_SECTOR_SIZE);
+	unmap_sector (&inode->data, idx);
+	map_sector (&inode->data, idx, sector);
+	inode->dirty = true;
+	return true;
+}
+
+/* Gives file sector IDX of INODE, which is a hole, a place to hold
+ * data: a zeroed delayed buffer if possible, otherwise a freshly
+ * allocated and zeroed disk sector.
+ * Returns false if the disk or the extent table is full. */
+static bool
+fill_hole (struct inode *inode, disk_sector_t idx) {
+	static char zeros[DISK_SECTOR_SIZE];
+	struct inode_disk *data = &inode->data;
+	disk_sector_t sector;
+	size_t i;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	if (is_delayed (inode, idx))
+		return true;
+
+	/* Each delayed sector may need an extent of its own once it is
+	 * placed, so extents and delayed sectors together must fit in
+	 * the extent table. */
+	if (inode->delayed_cnt == INODE_DELAYED_MAX
+			|| data->extent_cnt + inode->delayed_cnt >= INODE_EXTENT_CNT)
+		allocate_delayed (inode);
+	if (data->extent_cnt >= INODE_EXTENT_CNT)
+		return false;
+
+	/* The sector is reserved now, so that a full disk fails this
+	 * write and not the write-back. */
+	if (!free_map_reserve (1))
+		return false;
+	if (cache_add_delayed (inode, idx)) {
+		for (i = inode->delayed_cnt; i > 0 && inode->delayed[i - 1] > idx; i--)
+			inode->delayed[i] = inode->delayed[i - 1];
+		inode->delayed[i] = idx;
+		inode->delayed_cnt++;
+		return true;
+	}
+	free_map_unreserve (1);
+
+	/* The cache holds all the delayed data it may, so this sector
+	 * gets a disk sector right away. */
+	if (!free_map_allocate (1, &sector))
+		return false;
+	if (!map_sector (data, idx, sector)) {
+		free_map_release (sector, 1);
+		return false;
+	}
+	cache_write (sector, zeros, 0, DISK_SECTOR_SIZE);
+	inode->dirty = true;
+	return true;
+}
+
+/* Moves the data of INODE, which is stored inline, out to file
+ * sector 0, freeing the extent table for use.  The sector is
+ * delayed like any other new data if the cache allows.
+ * Returns false if the disk is full. */
+static bool
+move_inline (struct inode *inode) {
+	static char zeros[DISK_SECTOR_SIZE];
+	struct inode_disk *data = &inode->data;
+	disk_sector_t sector = -1;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+	ASSERT (data->flags & INODE_INLINE);
+	ASSERT (data->extent_cnt == 0 && inode->delayed_cnt == 0);
+
+	if (data->length > 0) {
+		if (!free_map_reserve (1))
+			return false;
+		if (cache_add_delayed (inode, 0)) {
+			cache_write_delayed (inode, 0, data->inline_data, 0, data->length);
+			inode->delayed[0] = 0;
+			inode->delayed_cnt = 1;
+		} else {
+			free_map_unreserve (1);
+			if (!free_map_allocate (1, &sector))
+				return false;
+			cache_write (sector, zeros, 0, DISK_SECTOR_SIZE);
+			cache_write (sector, data->inline_data, 0, data->length);
+		}
+	}
+
+	memset (data->inline_data, 0, sizeof data->inline_data);
+	data->flags &= ~INODE_INLINE;
+	if (sector != (disk_sector_t) -1)
+		map_sector (data, 0, sector);
+	inode->dirty = true;
+	return true;
+}
+
+/* Sectors of data stored compressed, and sectors they took. */
+static long long compress_in_cnt;
+static long long compress_out_cnt;
+
+/* Returns true if the SIZE bytes at BUFFER are all zeros. */
+static bool
+is_zeros (const uint8_t *buffer, size_t size) {
+	size_t i;
+
+	for (i = 0; i < size; i++)
+		if (buffer[i] != 0)
+			return false;
+	return true;
+}
+
+/* Compresses INODE's current chunk and writes it back, if it
+ * changed.  The chunk moves to newly allocated sectors if it needs
+ * a different number of them than before.  A chunk of zeros
+ * becomes a hole, and one that does not compress is stored raw.
+ * Returns false if the disk is full. */
+static bool
+store_chunk (struct inode *inode) {
+	struct chunk *c;
+	const uint8_t *data = inode->chunk;
+	size_t size = 0, sector_cnt = 0, i;
+	disk_sector_t start = 0;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	if (!inode->chunk_dirty)
+		return true;
+	c = &inode->data.chunks[inode->chunk_idx];
+
+	if (!is_zeros (inode->chunk, CHUNK_SIZE)) {
+		/* Compressing is only worth it if it saves a sector. */
+		size = compress (inode->chunk, CHUNK_SIZE, inode->scratch,
+				CHUNK_SIZE - DISK_SECTOR_SIZE, inode->scratch + CHUNK_SIZE);
+		if (size > 0) {
+			data = inode->scratch;
+			sector_cnt = DIV_ROUND_UP (size, DISK_SECTOR_SIZE);
+			memset (inode->scratch + size, 0,
+					sector_cnt * DISK_SECTOR_SIZE - size);
+		} else
+			sector_cnt = CHUNK_SECTORS;
+		compress_in_cnt += CHUNK_SECTORS;
+		compress_out_cnt += sector_cnt;
+	}
+
+	/* A chunk shared with a clone is never written in place. */
+	if (sector_cnt != c->sector_cnt
+			|| free_map_is_shared (c->start, c->sector_cnt)) {
+		if (sector_cnt > 0 && !free_map_allocate (sector_cnt, &start))
+			return false;
+		if (c->sector_cnt > 0)
+			free_map_release (c->start, c->sector_cnt);
+		c->start = start;
+		c->sector_cnt = sector_cnt;
+	}
+	c->size = size;
+	for (i = 0; i < sector_cnt; i++)
+		cache_write (c->start + i, data + i * DISK_SECTOR_SIZE, 0,
+				DISK_SECTOR_SIZE);
+
+	inode->chunk_dirty = false;
+	inode->dirty = true;
+	return true;
+}
+
+/* Makes chunk IDX of compressed INODE its current chunk, writing
+ * back the one it replaces.
+ * Returns false if memory or disk space runs out or the chunk is
+ * corrupt. */
+static bool
+load_chunk (struct inode *inode, disk_sector_t idx) {
+	const struct chunk *c = &inode->data.chunks[idx];
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+	ASSERT (idx < INODE_CHUNK_CNT);
+
+	if (inode->chunk_idx == idx)
+		return true;
+	if (inode->chunk == NULL) {
+		inode->chunk = malloc (CHUNK_SIZE);
+		inode->scratch = malloc (CHUNK_SIZE + COMPRESS_WORK_SIZE);
+		if (inode->chunk == NULL || inode->scratch == NULL) {
+			free (inode->chunk);
+			free (inode->scratch);
+			inode->chunk = inode->scratch = NULL;
+			return false;
+		}
+	}
+	if (!store_chunk (inode))
+		return false;
+	inode->chunk_idx = -1;
+
+	if (c->sector_cnt == 0)
+		memset (inode->chunk, 0, CHUNK_SIZE);
+	else {
+		/* Read the chunk's sectors in one request, after making sure
+		 * the disk has whatever the cache holds of them. */
+		uint8_t *buffer = c->size == 0 ? inode->chunk : inode->scratch;
+
+		cache_flush_range (c->start, c->sector_cnt);
+		direct_transfer (c->start, buffer, c->sector_cnt, false);
+		if (c->size > 0 && decompress (inode->scratch, c->size, inode->chunk,
+					CHUNK_SIZE) != CHUNK_SIZE)
+			return false;
+	}
+	inode->chunk_idx = idx;
+	return true;
+}
+
+/* Returns true if chunk IDX of compressed INODE holds data, on
+ * disk or in memory. */
+static bool
+chunk_allocated (const struct inode *inode, disk_sector_t idx) {
+	return inode->data.chunks[idx].sector_cnt > 0
+		|| (inode->chunk_idx == idx && inode->chunk_dirty);
+}
+
+/* Reads and writes of compressed files, like inode_read_at() and
+ * inode_write_at().  The inode stays locked throughout, so that
+ * the current chunk cannot change underfoot. */
+static off_t
+read_compressed (struct inode *inode, uint8_t *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_read = 0;
+
+	lock_acquire (&inode->lock);
+	while (size > 0 && offset < inode->data.length) {
+		int chunk_ofs = offset % CHUNK_SIZE;
+		off_t chunk_size = CHUNK_SIZE - chunk_ofs;
+		if (chunk_size > size)
+			chunk_size = size;
+		if (chunk_size > inode->data.length - offset)
+			chunk_size = inode->data.length - offset;
+
+		if (!load_chunk (inode, offset / CHUNK_SIZE))
+			break;
+		memcpy (buffer + bytes_read, inode->chunk + chunk_ofs, chunk_size);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	lock_release (&inode->lock);
+
+	return bytes_read;
+}
+
+static off_t
+write_compressed (struct inode *inode, const uint8_t *buffer, off_t size,
+		off_t offset) {
+	off_t bytes_written = 0;
+
+	lock_acquire (&inode->lock);
+	while (size > 0 && offset < INODE_COMPRESSED_MAX) {
+		int chunk_ofs = offset % CHUNK_SIZE;
+		off_t chunk_size = CHUNK_SIZE - chunk_ofs;
+		if (chunk_size > size)
+			chunk_size = size;
+
+		if (!load_chunk (inode, offset / CHUNK_SIZE))
+			break;
+		memcpy (inode->chunk + chunk_ofs, buffer + bytes_written, chunk_size);
+		inode->chunk_dirty = true;
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+		if (offset > inode->data.length) {
+			inode->data.length = offset;
+			inode->dirty = true;
+		}
+	}
+	lock_release (&inode->lock);
+
+	return bytes_written;
+}
+
+/* Picks sectors for INODE's delayed data and writes its on-disk
+ * inode to the cache if it changed. */
+static void
+inode_flush (struct inode *inode) {
+	if (inode->mem != NULL)
+		return;
+
+	lock_acquire (&inode->lock);
+	allocate_delayed (inode);
+	store_chunk (inode);
+	if (inode->dirty) {
+		cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+		inode->dirty = false;
+	}
+	lock_release (&inode->lock);
+}
+
+/* Forces INODE's data to disk, followed by the free map and then
+ * the on-disk inode, so that a crash never leaves the inode
+ * pointing at sectors that are unwritten or still marked free.
+ * If DATA_ONLY is true, the inode itself is written only when its
+ * length or layout changed, since nothing else in it is needed to
+ * read the data back.
+ * Returns false if the disk is too full to hold a compressed
+ * file's current chunk. */
+bool
+inode_sync (struct inode *inode, bool data_only) {
+	bool success;
+	size_t i;
+
+	if (inode->mem != NULL)
+		return true;
+
+	lock_acquire (&inode->lock);
+	allocate_delayed (inode);
+	success = store_chunk (inode);
+	for (i = 0; i < data_run_cnt (&inode->data); i++) {
+		disk_sector_t start;
+		size_t cnt = data_run (&inode->data, i, &start);
+		cache_flush_range (start, cnt);
+	}
+
+	if (!is_free_map (inode))
+		free_map_sync ();
+
+	if (inode->dirty) {
+		cache_write (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+		inode->dirty = false;
+		cache_flush_range (inode->sector, 1);
+	} else if (!data_only)
+		cache_flush_range (inode->sector, 1);
+	lock_release (&inode->lock);
+
+	return success;
 }
 
 /* List of open inodes, so that opening a single inode twice
  * returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Protects OPEN_INODES and each inode's OPEN_CNT. */
+static struct lock open_inodes_lock;
+
 /* Initializes the inode module. */
 void
 inode_init (void) {
 	list_init (&open_inodes);
+	lock_init (&open_inodes_lock);
+}
+
+/* Calls ACTION on each open inode.  ACTION may sleep, and inodes
+ * may be opened and closed meanwhile, so each inode is held open
+ * while ACTION runs, and the next one is held before it is let
+ * go, which keeps it in the list to go on from. */
+static void
+for_each_open (void (*action) (struct inode *)) {
+	struct list_elem *e;
+
+	lock_acquire (&open_inodes_lock);
+	e = list_begin (&open_inodes);
+	if (e != list_end (&open_inodes))
+		list_entry (e, struct inode, elem)->open_cnt++;
+	while (e != list_end (&open_inodes)) {
+		struct inode *inode = list_entry (e, struct inode, elem);
+
+		lock_release (&open_inodes_lock);
+		action (inode);
+		lock_acquire (&open_inodes_lock);
+		e = list_next (e);
+		if (e != list_end (&open_inodes))
+			list_entry (e, struct inode, elem)->open_cnt++;
+		lock_release (&open_inodes_lock);
+
+		inode_close (inode);
+		lock_acquire (&open_inodes_lock);
+	}
+	lock_release (&open_inodes_lock);
+}
+
+/* Writes back every open inode, so that the buffer cache holds
+ * all file data and metadata. */
+void
+inode_flush_all (void) {
+	for_each_open (inode_flush);
+}
+
+/* Forces INODE to disk, metadata included. */
+static void
+sync_inode (struct inode *inode) {
+	inode_sync (inode, false);
+}
+
+/* Forces every open inode to disk with inode_sync(). */
+void
+inode_sync_all (void) {
+	for_each_open (sync_inode);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
  * writes the new inode to sector SECTOR on the file system
- * disk.
+ * disk.  The data is zeros, stored inline if it is short enough
+ * and otherwise as one big hole, so no sectors are allocated.
  * Returns true if successful.
- * Returns false if memory or disk allocation fails. */
+ * Returns false if memory allocation fails. */
 bool
 inode_create (disk_sector_t sector, off_t length) {
 	struct inode_disk *disk_inode = NULL;
-	bool success = false;
 
 	ASSERT (length >= 0);
 
+	if (tmpfs_owns (sector))
+		return tmpfs_create (sector, length);
+
 	/* If this assertion fails, the inode structure is not exactly
 	 * one sector in size, and you should fix that. */
 	ASSERT (sizeof *disk_inode == DISK_SECTOR_SIZE);
 
+	disk_inode = calloc (1, sizeof *disk_inode);
+	if (disk_inode == NULL)
+		return false;
+
+	disk_inode->length = length;
+	disk_inode->magic = INODE_MAGIC;
+	if (length <= (off_t) INODE_INLINE_MAX)
+		disk_inode->flags = INODE_INLINE;
+	cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
+	free (disk_inode);
+	return true;
+}
+
+/* Like inode_create(), but allocates and zeroes all of the data up
+ * front, as one contiguous run, so that writes within LENGTH
+ * never allocate.  The free map is stored this way, because
+ * allocating sectors writes to it.
+ * Returns false if memory or disk allocation fails. */
+bool
+inode_create_allocated (disk_sector_t sector, off_t length) {
+	struct inode_disk *disk_inode = NULL;
+	bool success = false;
+
+	ASSERT (length >= 0);
+
 	disk_inode = calloc (1, sizeof *disk_inode);
 	if (disk_inode != NULL) {
 		size_t sectors = bytes_to_sectors (length);
+		disk_sector_t start;
+
 		disk_inode->length = length;
 		disk_inode->magic = INODE_MAGIC;
-		if (free_map_allocate (sectors, &disk_inode->start)) {
-			disk_write (filesys_disk, sector, disk_inode);
+		if (sectors == 0 || free_map_allocate (sectors, &start)) {
 			if (sectors > 0) {
 				static char zeros[DISK_SECTOR_SIZE];
 				size_t i;
 
-				for (i = 0; i < sectors; i++) 
-					disk_write (filesys_disk, disk_inode->start + i, zeros); 
+				disk_inode->extents[0].idx = 0;
+				disk_inode->extents[0].start = start;
+				disk_inode->extents[0].length = sectors;
+				disk_inode->extent_cnt = 1;
+				for (i = 0; i < sectors; i++)
+					cache_write (start + i, zeros, 0, DISK_SECTOR_SIZE);
 			}
+			cache_write (sector, disk_inode, 0, DISK_SECTOR_SIZE);
 			success = true; 
 		} 
 		free (disk_inode);
@@ -104,20 +1123,34 @@ inode_open (disk_sector_t sector) {
 	struct list_elem *e;
 	struct inode *inode;
 
-	/* Check whether this inode is already open. */
+	/* Check whether this inode is already open.  The lock is held
+	 * until a new inode is in the list and read in, so that no one
+	 * else opens it twice or sees it half built. */
+	lock_acquire (&open_inodes_lock);
 	for (e = list_begin (&open_inodes); e != list_end (&open_inodes);
 			e = list_next (e)) {
 		inode = list_entry (e, struct inode, elem);
 		if (inode->sector == sector) {
-			inode_reopen (inode);
+			inode->open_cnt++;
+			lock_release (&open_inodes_lock);
 			return inode; 
 		}
 	}
 
 	/* Allocate memory. */
 	inode = malloc (sizeof *inode);
-	if (inode == NULL)
+	if (inode == NULL) {
+		lock_release (&open_inodes_lock);
+		return NULL;
+	}
+
+	/* A tmpfs inode must exist already. */
+	inode->mem = NULL;
+	if (tmpfs_owns (sector) && (inode->mem = tmpfs_lookup (sector)) == NULL) {
+		lock_release (&open_inodes_lock);
+		free (inode);
 		return NULL;
+	}
 
 	/* Initialize. */
 	list_push_front (&open_inodes, &inode->elem);
@@ -125,15 +1158,30 @@ inode_open (disk_sector_t sector) {
 	inode->open_cnt = 1;
 	inode->deny_write_cnt = 0;
 	inode->removed = false;
-	disk_read (filesys_disk, inode->sector, &inode->data);
+	lock_init (&inode->lock);
+	inode->io_cnt = 0;
+	cond_init (&inode->io_done);
+	inode->dirty = false;
+	inode->delayed_cnt = 0;
+	inode->chunk = inode->scratch = NULL;
+	inode->chunk_idx = -1;
+	inode->chunk_dirty = false;
+	if (inode->mem != NULL)
+		memset (&inode->data, 0, sizeof inode->data);
+	else
+		cache_read (inode->sector, &inode->data, 0, DISK_SECTOR_SIZE);
+	lock_release (&open_inodes_lock);
 	return inode;
 }
 
 /* Reopens and returns INODE. */
 struct inode *
 inode_reopen (struct inode *inode) {
-	if (inode != NULL)
+	if (inode != NULL) {
+		lock_acquire (&open_inodes_lock);
 		inode->open_cnt++;
+		lock_release (&open_inodes_lock);
+	}
 	return inode;
 }
 
@@ -148,22 +1196,41 @@ inode_get_inumber (const struct inode *inode) {
  * If INODE was also a removed inode, frees its blocks. */
 void
 inode_close (struct inode *inode) {
+	bool last;
+
 	/* Ignore null pointer. */
 	if (inode == NULL)
 		return;
 
-	/* Release resources if this was the last opener. */
-	if (--inode->open_cnt == 0) {
-		/* Remove from inode list and release lock. */
+	lock_acquire (&open_inodes_lock);
+	last = --inode->open_cnt == 0;
+	if (last)
 		list_remove (&inode->elem);
+	lock_release (&open_inodes_lock);
 
-		/* Deallocate blocks if removed. */
-		if (inode->removed) {
+	/* Release resources if this was the last opener. */
+	if (last) {
+		/* Deallocate blocks if removed, otherwise write the inode
+		 * back. */
+		if (inode->mem != NULL) {
+			if (inode->removed)
+				tmpfs_remove (inode->sector);
+		} else if (inode->removed) {
+			size_t i;
+
+			discard_delayed (inode);
 			free_map_release (inode->sector, 1);
-			free_map_release (inode->data.start,
-					bytes_to_sectors (inode->data.length)); 
-		}
+			for (i = 0; i < data_run_cnt (&inode->data); i++) {
+				disk_sector_t start;
+				size_t cnt = data_run (&inode->data, i, &start);
+				if (cnt > 0)
+					free_map_release (start, cnt);
+			}
+		} else
+			inode_flush (inode);
 
+		free (inode->chunk);
+		free (inode->scratch);
 		free (inode); 
 	}
 }
@@ -178,16 +1245,36 @@ inode_remove (struct inode *inode) {
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
  * Returns the number of bytes actually read, which may be less
- * than SIZE if an error occurs or end of file is reached. */
+ * than SIZE if an error occurs or end of file is reached.
+ * Holes read as zeros. */
 off_t
 inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 	uint8_t *buffer = buffer_;
 	off_t bytes_read = 0;
-	uint8_t *bounce = NULL;
+
+	if (inode->mem != NULL)
+		return tmpfs_read (inode->mem, buffer, size, offset);
+
+	/* Inline data comes straight from the inode.  An inode never
+	 * goes back to inline once its data has moved out. */
+	lock_acquire (&inode->lock);
+	if (inode->data.flags & INODE_INLINE) {
+		if (offset < inode->data.length) {
+			bytes_read = inode->data.length - offset;
+			if (bytes_read > size)
+				bytes_read = size;
+			memcpy (buffer, inode->data.inline_data + offset, bytes_read);
+		}
+		lock_release (&inode->lock);
+		return bytes_read;
+	}
+	lock_release (&inode->lock);
+
+	if (inode->data.flags & INODE_COMPRESSED)
+		return read_compressed (inode, buffer, size, offset);
 
 	while (size > 0) {
-		/* Disk sector to read, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		/* Starting byte offset within sector. */
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -200,49 +1287,82 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset) {
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Read full sector directly into caller's buffer. */
-			disk_read (filesys_disk, sector_idx, buffer + bytes_read); 
-		} else {
-			/* Read sector into bounce buffer, then partially copy
-			 * into caller's buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
-			disk_read (filesys_disk, sector_idx, bounce);
-			memcpy (buffer + bytes_read, bounce + sector_ofs, chunk_size);
-		}
+		/* Disk sector to read. */
+		lock_acquire (&inode->lock);
+		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		bool delayed = is_delayed (inode, offset / DISK_SECTOR_SIZE);
+		if (sector_idx != (disk_sector_t) -1)
+			begin_io (inode);
+		lock_release (&inode->lock);
+
+		if (sector_idx != (disk_sector_t) -1) {
+			cache_read (sector_idx, buffer + bytes_read, sector_ofs, chunk_size);
+			end_io (inode);
+		} else if (!delayed)
+			memset (buffer + bytes_read, 0, chunk_size);
+		else if (!cache_read_delayed (inode, offset / DISK_SECTOR_SIZE,
+					buffer + bytes_read, sector_ofs, chunk_size))
+			/* The sector was allocated meanwhile.  Look it up again. */
+			continue;
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_read += chunk_size;
 	}
-	free (bounce);
 
 	return bytes_read;
 }
 
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
  * Returns the number of bytes actually written, which may be
- * less than SIZE if end of file is reached or an error occurs.
- * (Normally a write at end of file would extend the inode, but
- * growth is not yet implemented.) */
+ * less than SIZE if the disk fills up or an error occurs.
+ * A write past end of file extends the inode, leaving a hole
+ * between the old end of file and OFFSET. */
 off_t
 inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		off_t offset) {
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
-	uint8_t *bounce = NULL;
+	off_t old_length, end = offset + size;
 
 	if (inode->deny_write_cnt)
 		return 0;
+	if (inode->mem != NULL)
+		return tmpfs_write (inode->mem, buffer, size, offset);
+	if (inode->data.flags & INODE_COMPRESSED)
+		return write_compressed (inode, buffer, size, offset);
+
+	/* Write inline data in place while it still fits, and move it
+	 * out of the inode once it does not. */
+	lock_acquire (&inode->lock);
+	if (inode->data.flags & INODE_INLINE) {
+		if (offset + size <= (off_t) INODE_INLINE_MAX) {
+			memcpy (inode->data.inline_data + offset, buffer, size);
+			if (offset + size > inode->data.length)
+				inode->data.length = offset + size;
+			inode->dirty = true;
+			lock_release (&inode->lock);
+			return size;
+		}
+		if (!move_inline (inode)) {
+			lock_release (&inode->lock);
+			return 0;
+		}
+	}
+	lock_release (&inode->lock);
+
+	lock_acquire (&inode->lock);
+	old_length = inode->data.length;
+	if (end > inode->data.length) {
+		inode->data.length = end;
+		inode->dirty = true;
+	}
+	lock_release (&inode->lock);
 
 	while (size > 0) {
 		/* Sector to write, starting byte offset within sector. */
-		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		disk_sector_t idx = offset / DISK_SECTOR_SIZE;
 		int sector_ofs = offset % DISK_SECTOR_SIZE;
 
 		/* Bytes left in inode, bytes left in sector, lesser of the two. */
@@ -255,34 +1375,448 @@ inode_write_at (struct inode *inode, const void *buffer_, off_t size,
 		if (chunk_size <= 0)
 			break;
 
-		if (sector_ofs == 0 && chunk_size == DISK_SECTOR_SIZE) {
-			/* Write full sector directly to disk. */
-			disk_write (filesys_disk, sector_idx, buffer + bytes_written); 
-		} else {
-			/* We need a bounce buffer. */
-			if (bounce == NULL) {
-				bounce = malloc (DISK_SECTOR_SIZE);
-				if (bounce == NULL)
-					break;
-			}
+		/* Find the sector, filling it in if it is a hole or
+		 * unwritten.  Either, or giving the file its own copy of a
+		 * shared sector, may take up to two extents. */
+		lock_acquire (&inode->lock);
+		make_extent_room (inode, 2);
+		disk_sector_t sector_idx = byte_to_sector (inode, offset);
+		bool ok;
+		if (sector_unwritten (&inode->data, idx))
+			ok = write_unwritten (inode, idx);
+		else if (sector_idx == (disk_sector_t) -1)
+			ok = fill_hole (inode, idx);
+		else if (!is_free_map (inode) && free_map_is_shared (sector_idx, 1))
+			ok = unshare_sector (inode, idx, sector_idx);
+		else
+			ok = true;
+		if (ok)
+			sector_idx = byte_to_sector (inode, offset);
+		if (ok && sector_idx != (disk_sector_t) -1)
+			begin_io (inode);
+		lock_release (&inode->lock);
+		if (!ok)
+			break;
 
-			/* If the sector contains data before or after the chunk
-			   we're writing, then we need to read in the sector
-			   first.  Otherwise we start with a sector of all zeros. */
-			if (sector_ofs > 0 || chunk_size < sector_left) 
-				disk_read (filesys_disk, sector_idx, bounce);
-			else
-				memset (bounce, 0, DISK_SECTOR_SIZE);
-			memcpy (bounce + sector_ofs, buffer + bytes_written, chunk_size);
-			disk_write (filesys_disk, sector_idx, bounce); 
-		}
+		if (sector_idx != (disk_sector_t) -1) {
+			cache_write (sector_idx, buffer + bytes_written, sector_ofs,
+					chunk_size);
+			end_io (inode);
+		} else if (!cache_write_delayed (inode, idx, buffer + bytes_written,
+					sector_ofs, chunk_size))
+			/* The sector was allocated meanwhile.  Look it up again. */
+			continue;
 
 		/* Advance. */
 		size -= chunk_size;
 		offset += chunk_size;
 		bytes_written += chunk_size;
 	}
-	free (bounce);
+
+	/* If the write stopped short, the file only grows as far as the
+	 * data written, unless another write has grown it since. */
+	if (size > 0 && end > old_length) {
+		lock_acquire (&inode->lock);
+		if (inode->data.length == end) {
+			inode->data.length = offset > old_length ? offset : old_length;
+			inode->dirty = true;
+		}
+		lock_release (&inode->lock);
+	}
+
+	return bytes_written;
+}
+
+/* Finds the first run of file data in INODE that ends after byte
+ * OFFSET, skipping holes, and stores its bounds in *START and
+ * *LENGTH, rounded out to whole sectors but clipped to the end of
+ * the file.  Delayed data and unwritten extents count as
+ * allocated.
+ * Returns false if there is no data after OFFSET. */
+bool
+inode_allocated_range (struct inode *inode, off_t offset,
+		off_t *start, off_t *length) {
+	disk_sector_t idx, first = -1, end;
+	off_t start_ofs, end_ofs;
+	uint32_t i;
+
+	if (offset < 0 || offset >= inode_length (inode))
+		return false;
+	if (inode->mem != NULL)
+		return tmpfs_allocated_range (inode->mem, offset, start, length);
+	idx = offset / DISK_SECTOR_SIZE;
+
+	lock_acquire (&inode->lock);
+
+	if (inode->data.flags & INODE_INLINE) {
+		/* Inline data is all allocated. */
+		first = 0;
+		end = 1;
+	} else if (inode->data.flags & INODE_COMPRESSED) {
+		/* Find the first run of allocated chunks. */
+		for (i = idx / CHUNK_SECTORS; i < INODE_CHUNK_CNT; i++)
+			if (chunk_allocated (inode, i))
+				break;
+		if (i < INODE_CHUNK_CNT) {
+			first = i * CHUNK_SECTORS > idx ? i * CHUNK_SECTORS : idx;
+			while (i < INODE_CHUNK_CNT && chunk_allocated (inode, i))
+				i++;
+			end = i * CHUNK_SECTORS;
+		}
+	} else {
+		/* First mapped sector at or after IDX. */
+		for (i = 0; i < inode->data.extent_cnt; i++) {
+			const struct extent *e = &inode->data.extents[i];
+			if (e->idx + e->length > idx) {
+				first = e->idx > idx ? e->idx : idx;
+				break;
+			}
+		}
+		for (i = 0; i < inode->delayed_cnt; i++)
+			if (inode->delayed[i] >= idx && inode->delayed[i] < first) {
+				first = inode->delayed[i];
+				break;
+			}
+
+		/* Follow the run through adjoining extents and delayed
+		 * sectors. */
+		end = first;
+		if (first != (disk_sector_t) -1)
+			for (;;) {
+				const struct extent *e = find_extent (&inode->data, end);
+				if (e != NULL)
+					end = e->idx + e->length;
+				else if (is_delayed (inode, end))
+					end++;
+				else
+					break;
+			}
+	}
+
+	lock_release (&inode->lock);
+
+	if (first == (disk_sector_t) -1)
+		return false;
+	start_ofs = (off_t) first * DISK_SECTOR_SIZE;
+	end_ofs = (off_t) end * DISK_SECTOR_SIZE;
+	if (start_ofs >= inode_length (inode))
+		return false;
+	if (end_ofs > inode_length (inode))
+		end_ofs = inode_length (inode);
+	*start = start_ofs;
+	*length = end_ofs - start_ofs;
+	return true;
+}
+
+/* Reserves up to CNT contiguous disk sectors for the file sectors
+ * of INODE starting at IDX, which are holes, and maps them as an
+ * unwritten extent.  Settles for fewer sectors if free space is
+ * fragmented.
+ * Returns the number of sectors reserved, or 0 if the disk or the
+ * extent table is full. */
+static size_t
+reserve_run (struct inode *inode, disk_sector_t idx, size_t cnt) {
+	struct inode_disk *data = &inode->data;
+	disk_sector_t start;
+	struct extent *e;
+	uint32_t i;
+
+	ASSERT (lock_held_by_current_thread (&inode->lock));
+
+	if (data->extent_cnt + inode->delayed_cnt >= INODE_EXTENT_CNT)
+		return 0;
+	while (!free_map_allocate (cnt, &start))
+		if ((cnt /= 2) == 0)
+			return 0;
+
+	/* Find the first extent after IDX, and extend the one before it
+	 * if the new run continues it. */
+	for (i = 0; i < data->extent_cnt; i++)
+		if (data->extents[i].idx > idx)
+			break;
+	e = i > 0 ? &data->extents[i - 1] : NULL;
+	if (e != NULL && is_unwritten (data, i - 1)
+			&& e->idx + e->length == idx && e->start + e->length == start)
+		e->length += cnt;
+	else {
+		e = insert_extent (data, i, true);
+		e->idx = idx;
+		e->start = start;
+		e->length = cnt;
+	}
+	inode->dirty = true;
+	return cnt;
+}
+
+/* Reserves disk sectors for every hole in the LENGTH bytes of
+ * INODE starting at OFFSET, in as few contiguous runs as free
+ * space allows, so that writing there later does not allocate.
+ * The sectors are not written: they stay unwritten, reading as
+ * zeros, until the file's own data is written to them.  Extends
+ * the file to OFFSET + LENGTH bytes if it is shorter.
+ * Returns false if INODE is compressed or in tmpfs, or if the disk
+ * or the extent table fills up, in which case the sectors already
+ * reserved stay reserved. */
+bool
+inode_preallocate (struct inode *inode, off_t offset, off_t length) {
+	struct inode_disk *data = &inode->data;
+	disk_sector_t idx, end;
+	bool success = true;
+
+	ASSERT (offset >= 0 && length >= 0);
+
+	if (inode->mem != NULL || inode->deny_write_cnt)
+		return false;
+
+	lock_acquire (&inode->lock);
+	if (data->flags & INODE_COMPRESSED)
+		success = false;
+	else if ((data->flags & INODE_INLINE)
+			&& offset + length > (off_t) INODE_INLINE_MAX)
+		success = move_inline (inode);
+
+	/* Inline data needs no reservation.  Otherwise reserve each hole
+	 * in the range, skipping data on disk or in delayed buffers. */
+	idx = offset / DISK_SECTOR_SIZE;
+	end = bytes_to_sectors (offset + length);
+	while (success && !(data->flags & INODE_INLINE) && idx < end) {
+		const struct extent *e;
+		disk_sector_t hole_end;
+		size_t cnt;
+
+		make_extent_room (inode, 1);
+		e = find_extent (data, idx);
+		if (e != NULL) {
+			idx = e->idx + e->length;
+			continue;
+		}
+		if (is_delayed (inode, idx)) {
+			idx++;
+			continue;
+		}
+
+		for (hole_end = idx + 1; hole_end < end; hole_end++)
+			if (find_extent (data, hole_end) != NULL
+					|| is_delayed (inode, hole_end))
+				break;
+		cnt = reserve_run (inode, idx, hole_end - idx);
+		if (cnt == 0)
+			success = false;
+		idx += cnt;
+	}
+
+	if (success && offset + length > data->length) {
+		data->length = offset + length;
+		inode->dirty = true;
+	}
+	lock_release (&inode->lock);
+
+	return success;
+}
+
+/* Makes INODE store its data compressed from now on.
+ * Returns false, changing nothing, if INODE already holds data. */
+bool
+inode_set_compressed (struct inode *inode) {
+	bool success;
+
+	lock_acquire (&inode->lock);
+	success = inode->mem == NULL
+		&& inode->data.length == 0 && inode->data.extent_cnt == 0
+		&& inode->delayed_cnt == 0;
+	if (success && !(inode->data.flags & INODE_COMPRESSED)) {
+		memset (inode->data.chunks, 0, sizeof inode->data.chunks);
+		inode->data.flags = INODE_COMPRESSED;
+		inode->dirty = true;
+	}
+	lock_release (&inode->lock);
+
+	return success;
+}
+
+/* Creates at SECTOR a new inode holding the same data as INODE,
+ * without copying it: the two share INODE's data sectors until
+ * one of them writes to a sector, which then gets a private copy.
+ * Returns false if the disk is full, a sector already has too
+ * many owners, or INODE is in tmpfs. */
+bool
+inode_clone (struct inode *inode, disk_sector_t sector) {
+	bool success;
+	size_t i;
+
+	if (inode->mem != NULL)
+		return false;
+
+	lock_acquire (&inode->lock);
+
+	/* Only data on disk can be shared. */
+	allocate_delayed (inode);
+	success = store_chunk (inode);
+	for (i = 0; success && i < data_run_cnt (&inode->data); i++) {
+		disk_sector_t start;
+		size_t cnt = data_run (&inode->data, i, &start);
+		if (cnt > 0 && !free_map_share (start, cnt)) {
+			/* Undo the sharing done so far. */
+			while (i-- > 0)
+				if ((cnt = data_run (&inode->data, i, &start)) > 0)
+					free_map_release (start, cnt);
+			success = false;
+		}
+	}
+	if (success)
+		cache_write (sector, &inode->data, 0, DISK_SECTOR_SIZE);
+
+	lock_release (&inode->lock);
+	return success;
+}
+
+/* Returns the number of extents that INODE's data takes on disk,
+ * counting each chunk of a compressed file that has data as one. */
+size_t
+inode_extent_cnt (struct inode *inode) {
+	size_t cnt = 0;
+	size_t i;
+
+	if (inode->mem != NULL)
+		return 0;
+
+	lock_acquire (&inode->lock);
+	for (i = 0; i < data_run_cnt (&inode->data); i++) {
+		disk_sector_t start;
+		if (data_run (&inode->data, i, &start) > 0)
+			cnt++;
+	}
+	lock_release (&inode->lock);
+	return cnt;
+}
+
+/* Moves INODE's data, if it is spread over more than one extent,
+ * into one run of consecutive free sectors, in file order, so that
+ * it reads back sequentially.  See relocate() for the details.
+ * Returns true if the data moved.  Leaves alone tmpfs inodes and
+ * the free and refcount maps, as well as whatever relocate()
+ * does. */
+bool
+inode_defrag (struct inode *inode) {
+	bool moved;
+
+	if (inode->mem != NULL || is_free_map (inode))
+		return false;
+
+	lock_acquire (&inode->lock);
+	moved = relocate (inode);
+	lock_release (&inode->lock);
+	return moved;
+}
+
+/* Prints how well file data has compressed. */
+void
+inode_print_stats (void) {
+	if (compress_in_cnt > 0)
+		printf ("Compression: %lld sectors of data stored in %lld sectors "
+				"(%lld%%)\n", compress_in_cnt, compress_out_cnt,
+				compress_out_cnt * 100 / compress_in_cnt);
+}
+
+/* Reads SIZE bytes from INODE into BUFFER, starting at position
+ * OFFSET, like inode_read_at(), but moves data that is already on
+ * disk straight into BUFFER rather than through the buffer cache.
+ * OFFSET and SIZE must be multiples of DISK_SECTOR_SIZE. */
+off_t
+inode_read_direct (struct inode *inode, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	ASSERT (offset % DISK_SECTOR_SIZE == 0 && size % DISK_SECTOR_SIZE == 0);
+
+	if (inode->mem != NULL)
+		return inode_read_at (inode, buffer, size, offset);
+
+	while (size > 0) {
+		size_t cnt;
+		disk_sector_t sector;
+
+		lock_acquire (&inode->lock);
+		sector = sector_run (inode, offset, size / DISK_SECTOR_SIZE, &cnt);
+		if (sector != (disk_sector_t) -1)
+			begin_io (inode);
+		lock_release (&inode->lock);
+
+		if (sector == (disk_sector_t) -1) {
+			/* A hole, delayed data, or the end of the file. */
+			off_t chunk = inode_read_at (inode, buffer, DISK_SECTOR_SIZE, offset);
+			bytes_read += chunk;
+			if (chunk < DISK_SECTOR_SIZE)
+				break;
+			cnt = 1;
+		} else {
+			/* The cache may hold newer data than the disk. */
+			cache_flush_range (sector, cnt);
+			direct_transfer (sector, buffer, cnt, false);
+			end_io (inode);
+			bytes_read += cnt * DISK_SECTOR_SIZE;
+		}
+
+		buffer += cnt * DISK_SECTOR_SIZE;
+		offset += cnt * DISK_SECTOR_SIZE;
+		size -= cnt * DISK_SECTOR_SIZE;
+	}
+
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET,
+ * like inode_write_at(), but writes sectors that already have a
+ * place on disk straight from BUFFER rather than through the
+ * buffer cache.  Holes and growth still go through the cache.
+ * OFFSET and SIZE must be multiples of DISK_SECTOR_SIZE. */
+off_t
+inode_write_direct (struct inode *inode, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	ASSERT (offset % DISK_SECTOR_SIZE == 0 && size % DISK_SECTOR_SIZE == 0);
+
+	if (inode->deny_write_cnt)
+		return 0;
+	if (inode->mem != NULL)
+		return inode_write_at (inode, buffer, size, offset);
+
+	while (size > 0) {
+		size_t cnt;
+		disk_sector_t sector;
+
+		lock_acquire (&inode->lock);
+		sector = sector_run (inode, offset, size / DISK_SECTOR_SIZE, &cnt);
+		if (sector != (disk_sector_t) -1 && free_map_is_shared (sector, cnt))
+			sector = -1;
+		if (sector != (disk_sector_t) -1)
+			begin_io (inode);
+		lock_release (&inode->lock);
+
+		if (sector == (disk_sector_t) -1) {
+			/* A hole, shared sectors, or growth. */
+			off_t chunk = inode_write_at (inode, buffer, DISK_SECTOR_SIZE,
+					offset);
+			bytes_written += chunk;
+			if (chunk < DISK_SECTOR_SIZE)
+				break;
+			cnt = 1;
+		} else {
+			/* Cached copies would overwrite the new data on eviction. */
+			cache_invalidate_range (sector, cnt);
+			direct_transfer (sector, (uint8_t *) buffer, cnt, true);
+			cache_invalidate_range (sector, cnt);
+			end_io (inode);
+			bytes_written += cnt * DISK_SECTOR_SIZE;
+		}
+
+		buffer += cnt * DISK_SECTOR_SIZE;
+		offset += cnt * DISK_SECTOR_SIZE;
+		size -= cnt * DISK_SECTOR_SIZE;
+	}
 
 	return bytes_written;
 }
@@ -309,5 +1843,7 @@ inode_allow_write (struct inode *inode) {
 /* Returns the length, in bytes, of INODE's data. */
 off_t
 inode_length (const struct inode *inode) {
+	if (inode->mem != NULL)
+		return tmpfs_length (inode->mem);
 	return inode->data.length;
 }
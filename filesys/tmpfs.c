@@ -0,0 +1,262 @@
+/* tmpfs.c: File system kept entirely in memory.
+ *
+ * A tmpfs inode is a node in a list, named by an inode number
+ * above TMPFS_INUMBER_BASE, whose data lives in whole pages.  The
+ * inode layer hands reads and writes of such inodes to this
+ * module, so that files and directories in tmpfs work through the
+ * usual `struct file' and `struct dir' interfaces.  Nothing is
+ * written to disk, and everything is lost at shutdown. */
+
+#include "filesys/tmpfs.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <string.h>
+#include "filesys/directory.h"
+#include "threads/malloc.h"
+#include "threads/palloc.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* A tmpfs inode. */
+struct tmpfs_node {
+	struct list_elem elem;              /* Element in node list. */
+	disk_sector_t inumber;              /* Inode number. */
+	off_t length;                       /* File size in bytes. */
+	size_t page_cnt;                    /* Number of elements in PAGES. */
+	uint8_t **pages;                    /* Data pages, null for holes. */
+};
+
+/* All the nodes, and the data pages they use.  One lock covers
+ * them all, since tmpfs never waits for I/O while holding it. */
+static struct list nodes;
+static size_t used_pages;
+static struct lock tmpfs_lock;
+
+/* Next inode number to hand out. */
+static disk_sector_t next_inumber;
+
+/* Initializes tmpfs with an empty root directory. */
+void
+tmpfs_init (void) {
+	list_init (&nodes);
+	lock_init (&tmpfs_lock);
+	next_inumber = TMPFS_ROOT_INUMBER + 1;
+
+	if (!dir_create (TMPFS_ROOT_INUMBER, 16))
+		PANIC ("tmpfs root directory creation failed");
+}
+
+/* Stores an unused inode number in *INUMBER.
+ * Returns false if there are none left. */
+bool
+tmpfs_allocate (disk_sector_t *inumber) {
+	bool success;
+
+	lock_acquire (&tmpfs_lock);
+	success = next_inumber != 0;
+	if (success)
+		*inumber = next_inumber++;
+	lock_release (&tmpfs_lock);
+
+	return success;
+}
+
+/* Returns the node numbered INUMBER, or a null pointer. */
+static struct tmpfs_node *
+find_node (disk_sector_t inumber) {
+	struct list_elem *e;
+
+	ASSERT (lock_held_by_current_thread (&tmpfs_lock));
+
+	for (e = list_begin (&nodes); e != list_end (&nodes); e = list_next (e)) {
+		struct tmpfs_node *node = list_entry (e, struct tmpfs_node, elem);
+		if (node->inumber == inumber)
+			return node;
+	}
+	return NULL;
+}
+
+/* Creates inode INUMBER with LENGTH bytes of zeros, which take no
+ * memory until they are written.
+ * Returns false if memory allocation fails. */
+bool
+tmpfs_create (disk_sector_t inumber, off_t length) {
+	struct tmpfs_node *node;
+
+	ASSERT (tmpfs_owns (inumber));
+	ASSERT (length >= 0);
+
+	node = calloc (1, sizeof *node);
+	if (node == NULL)
+		return false;
+	node->inumber = inumber;
+	node->length = length;
+
+	lock_acquire (&tmpfs_lock);
+	ASSERT (find_node (inumber) == NULL);
+	list_push_back (&nodes, &node->elem);
+	lock_release (&tmpfs_lock);
+	return true;
+}
+
+/* Returns inode INUMBER, or a null pointer if it does not
+ * exist. */
+struct tmpfs_node *
+tmpfs_lookup (disk_sector_t inumber) {
+	struct tmpfs_node *node;
+
+	lock_acquire (&tmpfs_lock);
+	node = find_node (inumber);
+	lock_release (&tmpfs_lock);
+
+	return node;
+}
+
+/* Deletes inode INUMBER and frees its data, if it exists. */
+void
+tmpfs_remove (disk_sector_t inumber) {
+	struct tmpfs_node *node;
+	size_t i;
+
+	lock_acquire (&tmpfs_lock);
+	node = find_node (inumber);
+	if (node != NULL) {
+		list_remove (&node->elem);
+		for (i = 0; i < node->page_cnt; i++)
+			if (node->pages[i] != NULL) {
+				palloc_free_page (node->pages[i]);
+				used_pages--;
+			}
+	}
+	lock_release (&tmpfs_lock);
+
+	if (node != NULL) {
+		free (node->pages);
+		free (node);
+	}
+}
+
+/* Reads SIZE bytes from NODE into BUFFER, starting at position
+ * OFFSET.  Returns the number of bytes read, which is less than
+ * SIZE if end of file is reached.  Holes read as zeros. */
+off_t
+tmpfs_read (struct tmpfs_node *node, void *buffer_, off_t size,
+		off_t offset) {
+	uint8_t *buffer = buffer_;
+	off_t bytes_read = 0;
+
+	lock_acquire (&tmpfs_lock);
+	while (size > 0 && offset < node->length) {
+		size_t idx = offset / PGSIZE;
+		int page_ofs = offset % PGSIZE;
+		off_t chunk_size = PGSIZE - page_ofs;
+		if (chunk_size > size)
+			chunk_size = size;
+		if (chunk_size > node->length - offset)
+			chunk_size = node->length - offset;
+
+		if (idx < node->page_cnt && node->pages[idx] != NULL)
+			memcpy (buffer + bytes_read, node->pages[idx] + page_ofs, chunk_size);
+		else
+			memset (buffer + bytes_read, 0, chunk_size);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_read += chunk_size;
+	}
+	lock_release (&tmpfs_lock);
+
+	return bytes_read;
+}
+
+/* Writes SIZE bytes from BUFFER into NODE, starting at OFFSET,
+ * extending the file if necessary.  Returns the number of bytes
+ * written, which is less than SIZE if memory runs out or tmpfs is
+ * full. */
+off_t
+tmpfs_write (struct tmpfs_node *node, const void *buffer_, off_t size,
+		off_t offset) {
+	const uint8_t *buffer = buffer_;
+	off_t bytes_written = 0;
+
+	lock_acquire (&tmpfs_lock);
+	while (size > 0) {
+		size_t idx = offset / PGSIZE;
+		int page_ofs = offset % PGSIZE;
+		off_t chunk_size = PGSIZE - page_ofs;
+		if (chunk_size > size)
+			chunk_size = size;
+
+		/* Grow the page table to cover IDX. */
+		if (idx >= node->page_cnt) {
+			size_t page_cnt = idx + 1 > node->page_cnt * 2 ? idx + 1
+				: node->page_cnt * 2;
+			uint8_t **pages = realloc (node->pages, page_cnt * sizeof *pages);
+			if (pages == NULL)
+				break;
+			memset (pages + node->page_cnt, 0,
+					(page_cnt - node->page_cnt) * sizeof *pages);
+			node->pages = pages;
+			node->page_cnt = page_cnt;
+		}
+
+		/* Fill a hole with a page of zeros. */
+		if (node->pages[idx] == NULL) {
+			if (used_pages == TMPFS_PAGE_MAX)
+				break;
+			node->pages[idx] = palloc_get_page (PAL_USER | PAL_ZERO);
+			if (node->pages[idx] == NULL)
+				break;
+			used_pages++;
+		}
+
+		memcpy (node->pages[idx] + page_ofs, buffer + bytes_written, chunk_size);
+
+		size -= chunk_size;
+		offset += chunk_size;
+		bytes_written += chunk_size;
+		if (offset > node->length)
+			node->length = offset;
+	}
+	lock_release (&tmpfs_lock);
+
+	return bytes_written;
+}
+
+/* Returns the length, in bytes, of NODE's data. */
+off_t
+tmpfs_length (const struct tmpfs_node *node) {
+	return node->length;
+}
+
+/* Finds the first run of written pages in NODE that ends after
+ * byte OFFSET, like inode_allocated_range().
+ * Returns false if there is no data after OFFSET. */
+bool
+tmpfs_allocated_range (struct tmpfs_node *node, off_t offset,
+		off_t *start, off_t *length) {
+	size_t first, end;
+	off_t start_ofs, end_ofs;
+
+	lock_acquire (&tmpfs_lock);
+	for (first = offset / PGSIZE; first < node->page_cnt; first++)
+		if (node->pages[first] != NULL)
+			break;
+	for (end = first; end < node->page_cnt; end++)
+		if (node->pages[end] == NULL)
+			break;
+	start_ofs = (off_t) first * PGSIZE;
+	end_ofs = (off_t) end * PGSIZE;
+	if (end_ofs > node->length)
+		end_ofs = node->length;
+	lock_release (&tmpfs_lock);
+
+	if (start_ofs >= end_ofs)
+		return false;
+	if (start_ofs < offset)
+		start_ofs = ROUND_DOWN (offset, DISK_SECTOR_SIZE);
+	*start = start_ofs;
+	*length = end_ofs - start_ofs;
+	return true;
+}
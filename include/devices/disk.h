@@ -1,8 +1,13 @@
 #ifndef DEVICES_DISK_H
 #define DEVICES_DISK_H
 
+#include <disk-stats.h>
 #include <inttypes.h>
+#include <list.h>
+#include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
+#include "threads/synch.h"
 
 /* Size of a disk sector in bytes. */
 #define DISK_SECTOR_SIZE 512
@@ -15,13 +20,42 @@ typedef uint32_t disk_sector_t;
  * printf ("sector=%"PRDSNu"\n", sector); */
 #define PRDSNu PRIu32
 
+/* A request to transfer consecutive sectors to or from a disk.
+ * Requests are queued per channel and served by the channel's
+ * own thread, which may merge a request with its neighbours on
+ * the disk into a single command. */
+struct disk_request {
+	struct list_elem elem;      /* Element in the channel's queue. */
+	struct disk *disk;          /* Disk to transfer to or from. */
+	bool write;                 /* Write to disk?  Otherwise, read. */
+	enum disk_class class;      /* On whose behalf, for statistics. */
+	disk_sector_t sec_no;       /* First sector. */
+	void *buffer;               /* CNT * DISK_SECTOR_SIZE bytes. */
+	size_t cnt;                 /* Number of sectors. */
+	int64_t submit_tick;        /* When submitted. */
+	int64_t deadline;           /* Serve ahead of others after this tick. */
+
+	/* If non-null, called by the channel's thread once the
+	 * transfer is done.  Must not sleep for long. */
+	void (*done) (struct disk_request *);
+	void *aux;                  /* For use by DONE. */
+	struct semaphore finished;  /* Up'd once the transfer is done. */
+};
+
 void disk_init (void);
 void disk_print_stats (void);
+bool disk_get_stats (struct disk *, enum disk_class, bool write,
+		struct disk_stats *);
 
 struct disk *disk_get (int chan_no, int dev_no);
 disk_sector_t disk_size (struct disk *);
 void disk_read (struct disk *, disk_sector_t, void *);
 void disk_write (struct disk *, disk_sector_t, const void *);
 
+void disk_request_init (struct disk_request *, struct disk *, bool write,
+		enum disk_class, disk_sector_t, void *buffer, size_t cnt);
+void disk_submit (struct disk_request *);
+void disk_wait (struct disk_request *);
+
 void register_disk_inspect_intr ();
 #endif /* devices/disk.h */
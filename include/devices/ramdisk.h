@@ -0,0 +1,17 @@
+#ifndef DEVICES_RAMDISK_H
+#define DEVICES_RAMDISK_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+struct ramdisk;
+
+void ramdisk_configure (char *spec);
+void ramdisk_init (void);
+struct ramdisk *ramdisk_get (int chan_no, int dev_no);
+disk_sector_t ramdisk_capacity (const struct ramdisk *);
+void ramdisk_transfer (struct ramdisk *, bool write, disk_sector_t,
+		void *buffer, size_t cnt);
+
+#endif /* devices/ramdisk.h */
@@ -0,0 +1,14 @@
+#ifndef DEVICES_VIRTIO_BLK_H
+#define DEVICES_VIRTIO_BLK_H
+
+#include <list.h>
+#include "devices/disk.h"
+
+struct virtio_blk;
+
+void virtio_blk_init (void);
+struct virtio_blk *virtio_blk_get (int chan_no, int dev_no);
+disk_sector_t virtio_blk_capacity (const struct virtio_blk *);
+void virtio_blk_transfer (struct virtio_blk *, struct list *batch);
+
+#endif /* devices/virtio-blk.h */
@@ -0,0 +1,38 @@
+#ifndef FILESYS_CACHE_H
+#define FILESYS_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "devices/disk.h"
+
+struct inode;
+
+/* Number of sectors held in the buffer cache. */
+#define CACHE_SIZE 64
+
+/* Maximum number of cache entries that may hold data whose disk
+ * sector has not been chosen yet (delayed allocation). */
+#define CACHE_DELAYED_MAX (CACHE_SIZE / 2)
+
+void cache_init (void);
+void cache_done (void);
+void cache_flush (void);
+void cache_flush_range (disk_sector_t start, size_t cnt);
+void cache_invalidate_range (disk_sector_t start, size_t cnt);
+
+/* Sectors that already live on disk. */
+void cache_read (disk_sector_t, void *, int ofs, int size);
+void cache_write (disk_sector_t, const void *, int ofs, int size);
+void cache_copy (disk_sector_t dst, disk_sector_t src);
+
+/* Delayed-allocation buffers, named by inode and file sector index. */
+bool cache_add_delayed (const struct inode *, disk_sector_t idx);
+bool cache_read_delayed (const struct inode *, disk_sector_t idx,
+		void *, int ofs, int size);
+bool cache_write_delayed (const struct inode *, disk_sector_t idx,
+		const void *, int ofs, int size);
+void cache_assign_delayed (const struct inode *, disk_sector_t idx,
+		disk_sector_t sector);
+void cache_discard_delayed (const struct inode *);
+
+#endif /* filesys/cache.h */
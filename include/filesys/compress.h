@@ -0,0 +1,16 @@
+#ifndef FILESYS_COMPRESS_H
+#define FILESYS_COMPRESS_H
+
+#include <stddef.h>
+
+/* Largest block compress() accepts. */
+#define COMPRESS_MAX 65536
+
+/* Bytes of scratch space compress() needs. */
+#define COMPRESS_WORK_SIZE 8192
+
+size_t compress (const void *src, size_t size, void *dst, size_t cap,
+		void *work);
+size_t decompress (const void *src, size_t size, void *dst, size_t cap);
+
+#endif /* filesys/compress.h */
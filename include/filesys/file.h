@@ -1,6 +1,7 @@
 #ifndef FILESYS_FILE_H
 #define FILESYS_FILE_H
 
+#include <stdbool.h>
 #include "filesys/off_t.h"
 
 struct inode;
@@ -27,4 +28,22 @@ void file_seek (struct file *, off_t);
 off_t file_tell (struct file *);
 off_t file_length (struct file *);
 
+/* Direct I/O. */
+void file_set_direct (struct file *, bool);
+bool file_is_direct (struct file *);
+off_t file_read_direct (struct file *, void *, off_t);
+off_t file_write_direct (struct file *, const void *, off_t);
+
+/* Compression. */
+bool file_set_compressed (struct file *);
+
+/* Durability. */
+bool file_sync (struct file *);
+bool file_datasync (struct file *);
+
+/* Sparse files. */
+bool file_allocated_range (struct file *, off_t offset,
+		off_t *start, off_t *length);
+bool file_preallocate (struct file *, off_t offset, off_t length);
+
 #endif /* filesys/file.h */
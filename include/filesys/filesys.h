@@ -2,12 +2,16 @@
 #define FILESYS_FILESYS_H
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <dirent.h>
+#include <frag-stats.h>
 #include "filesys/off_t.h"
 #include "threads/synch.h"
 
 /* Sectors of system file inodes. */
 #define FREE_MAP_SECTOR 0       /* Free map file inode sector. */
 #define ROOT_DIR_SECTOR 1       /* Root directory file inode sector. */
+#define REFCOUNT_MAP_SECTOR 2   /* Refcount map file inode sector. */
 
 /* Disk used for file system. */
 extern struct disk *filesys_disk;
@@ -16,8 +20,12 @@ extern struct lock filesys_lock;
 
 void filesys_init (bool format);
 void filesys_done (void);
+void filesys_sync (void);
 bool filesys_create (const char *name, off_t initial_size);
+bool filesys_clone (const char *name, const char *new_name);
 struct file *filesys_open (const char *name);
 bool filesys_remove (const char *name);
+int filesys_getdents (const char *dir, off_t *pos, struct dirent *, size_t cnt);
+int filesys_defrag (struct frag_stats *before, struct frag_stats *after);
 
 #endif /* filesys/filesys.h */
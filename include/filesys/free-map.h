@@ -10,8 +10,15 @@ void free_map_read (void);
 void free_map_create (void);
 void free_map_open (void);
 void free_map_close (void);
+void free_map_sync (void);
 
 bool free_map_allocate (size_t, disk_sector_t *);
+bool free_map_allocate_reserved (size_t, disk_sector_t *);
+bool free_map_reserve (size_t);
+void free_map_unreserve (size_t);
 void free_map_release (disk_sector_t, size_t);
+bool free_map_share (disk_sector_t, size_t);
+bool free_map_is_shared (disk_sector_t, size_t);
+void free_map_stats (size_t *free_cnt, size_t *run_cnt, size_t *run_max);
 
 #endif /* filesys/free-map.h */
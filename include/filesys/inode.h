@@ -9,6 +9,7 @@ struct bitmap;
 
 void inode_init (void);
 bool inode_create (disk_sector_t, off_t);
+bool inode_create_allocated (disk_sector_t, off_t);
 struct inode *inode_open (disk_sector_t);
 struct inode *inode_reopen (struct inode *);
 disk_sector_t inode_get_inumber (const struct inode *);
@@ -16,8 +17,22 @@ void inode_close (struct inode *);
 void inode_remove (struct inode *);
 off_t inode_read_at (struct inode *, void *, off_t size, off_t offset);
 off_t inode_write_at (struct inode *, const void *, off_t size, off_t offset);
+off_t inode_read_direct (struct inode *, void *, off_t size, off_t offset);
+off_t inode_write_direct (struct inode *, const void *, off_t size,
+		off_t offset);
 void inode_deny_write (struct inode *);
 void inode_allow_write (struct inode *);
 off_t inode_length (const struct inode *);
+bool inode_allocated_range (struct inode *, off_t offset,
+		off_t *start, off_t *length);
+bool inode_set_compressed (struct inode *);
+bool inode_preallocate (struct inode *, off_t offset, off_t length);
+size_t inode_extent_cnt (struct inode *);
+bool inode_defrag (struct inode *);
+bool inode_clone (struct inode *, disk_sector_t);
+void inode_flush_all (void);
+bool inode_sync (struct inode *, bool data_only);
+void inode_sync_all (void);
+void inode_print_stats (void);
 
 #endif /* filesys/inode.h */
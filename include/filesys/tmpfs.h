@@ -0,0 +1,42 @@
+#ifndef FILESYS_TMPFS_H
+#define FILESYS_TMPFS_H
+
+#include <stdbool.h>
+#include "devices/disk.h"
+#include "filesys/off_t.h"
+
+/* Mount point of the in-memory file system, in the root
+ * directory. */
+#define TMPFS_MOUNT "tmp"
+
+/* Inode numbers at or above TMPFS_INUMBER_BASE name tmpfs inodes
+ * rather than disk sectors.  The first is the tmpfs root
+ * directory. */
+#define TMPFS_INUMBER_BASE 0x80000000u
+#define TMPFS_ROOT_INUMBER TMPFS_INUMBER_BASE
+
+/* Largest total size of tmpfs file data, in pages. */
+#define TMPFS_PAGE_MAX 1024
+
+struct tmpfs_node;
+
+/* Returns true if INUMBER names a tmpfs inode. */
+static inline bool
+tmpfs_owns (disk_sector_t inumber) {
+	return inumber >= TMPFS_INUMBER_BASE;
+}
+
+void tmpfs_init (void);
+bool tmpfs_allocate (disk_sector_t *);
+bool tmpfs_create (disk_sector_t, off_t);
+struct tmpfs_node *tmpfs_lookup (disk_sector_t);
+void tmpfs_remove (disk_sector_t);
+
+off_t tmpfs_read (struct tmpfs_node *, void *, off_t size, off_t offset);
+off_t tmpfs_write (struct tmpfs_node *, const void *, off_t size,
+		off_t offset);
+off_t tmpfs_length (const struct tmpfs_node *);
+bool tmpfs_allocated_range (struct tmpfs_node *, off_t offset,
+		off_t *start, off_t *length);
+
+#endif /* filesys/tmpfs.h */
@@ -8,7 +8,7 @@
    of the Page Directory". */
 __attribute__((always_inline))
 static __inline void lcr3(uint64_t val) {
-	__asm __volatile("movq %0, %%cr3" : : "r" (val));
+	__asm __volatile("movq %0, %%cr3" : : "r" (val) : "memory");
 }
 
 __attribute__((always_inline))
@@ -119,6 +119,14 @@ static __inline uint64_t rcr2(void) {
 	return val;
 }
 
+__attribute__((always_inline))
+static __inline uint64_t read_msr(uint32_t ecx) {
+	uint32_t edx, eax;
+	__asm __volatile("rdmsr"
+			: "=d" (edx), "=a" (eax) : "c" (ecx));
+	return ((uint64_t) edx << 32) | eax;
+}
+
 __attribute__((always_inline))
 static __inline void write_msr(uint32_t ecx, uint64_t val) {
 	uint32_t edx, eax;
@@ -0,0 +1,23 @@
+#ifndef __LIB_DIRENT_H
+#define __LIB_DIRENT_H
+
+/* Directory entries, shared by the kernel and user programs
+   through the getdents system call. */
+
+/* Maximum length of a name in a directory entry. */
+#define DIRENT_NAME_MAX 14
+
+/* What a directory entry names. */
+enum dirent_type {
+	DT_REG = 1,                 /* Regular file. */
+	DT_DIR                      /* Directory. */
+};
+
+/* One directory entry. */
+struct dirent {
+	int inumber;                /* Inode number. */
+	enum dirent_type type;      /* Type of file. */
+	char name[DIRENT_NAME_MAX + 1]; /* Null terminated file name. */
+};
+
+#endif /* lib/dirent.h */
@@ -0,0 +1,36 @@
+#ifndef __LIB_DISK_STATS_H
+#define __LIB_DISK_STATS_H
+
+/* Disk I/O statistics, shared by the kernel and user programs
+   through the disk_stats system call. */
+
+/* Who a disk request is on behalf of. */
+enum disk_class {
+	DISK_OTHER,                 /* Kernel image and anything else. */
+	DISK_FILESYS,               /* File system. */
+	DISK_SWAP,                  /* Swapping. */
+	DISK_FSUTIL,                /* File copies to and from the scratch disk. */
+	DISK_CLASS_CNT
+};
+
+/* Number of histogram buckets.  Bucket 0 counts requests that
+   took no timer tick; bucket I, for I > 0, those that took
+   2**(I - 1) to 2**I - 1 ticks; and the last bucket everything
+   longer. */
+#define DISK_HIST_CNT 8
+
+/* Statistics for one class of requests in one direction on one
+   disk. */
+struct disk_stats {
+	long long request_cnt;      /* Requests served. */
+	long long sector_cnt;       /* Sectors moved. */
+	long long seq_cnt;          /* Requests that began where the last ended. */
+
+	/* Ticks from submission until the disk started on it. */
+	long long wait_hist[DISK_HIST_CNT];
+
+	/* Ticks from the disk starting on it until completion. */
+	long long service_hist[DISK_HIST_CNT];
+};
+
+#endif /* lib/disk-stats.h */
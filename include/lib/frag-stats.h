@@ -0,0 +1,14 @@
+#ifndef __LIB_FRAG_STATS_H
+#define __LIB_FRAG_STATS_H
+
+/* File system fragmentation, shared by the kernel and user
+   programs through the defrag system call. */
+struct frag_stats {
+	int file_cnt;               /* Files, counting the root directory. */
+	int extent_cnt;             /* Extents those files' data takes. */
+	int free_cnt;               /* Free sectors. */
+	int free_run_cnt;           /* Runs of consecutive free sectors. */
+	int free_run_max;           /* Sectors in the longest free run. */
+};
+
+#endif /* lib/frag-stats.h */
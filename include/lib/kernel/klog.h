@@ -0,0 +1,24 @@
+#ifndef __LIB_KERNEL_KLOG_H
+#define __LIB_KERNEL_KLOG_H
+
+#include <debug.h>
+#include <stddef.h>
+
+/* Severity of a log message, most severe first. */
+enum klog_level {
+	KLOG_ERR,                   /* Something failed. */
+	KLOG_WARN,                  /* Something looks wrong. */
+	KLOG_INFO,                  /* Normal but notable event. */
+	KLOG_DEBUG,                 /* Debugging detail. */
+	KLOG_LEVEL_CNT
+};
+
+/* Messages this severe or more also go to the console. */
+extern enum klog_level klog_console_level;
+
+void klog_init (void);
+void klog (enum klog_level, const char *format, ...) PRINTF_FORMAT (2, 3);
+void klog_flush (void);
+size_t klog_read (char *buffer, size_t size);
+
+#endif /* lib/kernel/klog.h */
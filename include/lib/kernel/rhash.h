@@ -0,0 +1,110 @@
+#ifndef __LIB_KERNEL_RHASH_H
+#define __LIB_KERNEL_RHASH_H
+
+/* Open-addressing hash table.
+ *
+ * This table offers the same kind of interface as the chained
+ * table in hash.h, but keeps its elements in a single array of
+ * slots, each holding a pointer to the element and the element's
+ * hash value.  A lookup compares hash values in consecutive slots
+ * and only follows a pointer to call the comparison function when
+ * the hash values match, so it touches one or two cache lines
+ * instead of walking a list.
+ *
+ * Collisions are resolved with Robin Hood linear probing: an
+ * element being inserted takes the slot of any element that is
+ * closer to its own home slot, which keeps probe sequences short
+ * and lets a failed lookup stop early.
+ *
+ * When the table grows or shrinks, the old slot array is not
+ * emptied into the new one all at once.  Instead, each insertion
+ * and deletion moves a few old slots' worth of elements, and
+ * lookups search both arrays until the old one is drained, so no
+ * single operation pays for the whole move.
+ *
+ * As with hash.h, each structure that can be in a table embeds a
+ * struct rhash_elem, and rhash_entry() converts a pointer to that
+ * member back into a pointer to the structure. */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/* Hash element.  The table refers to elements only by address,
+ * so an element needs no space of its own; the member just gives
+ * rhash_entry() something to point to. */
+struct rhash_elem {
+	uint8_t unused;
+};
+
+/* Converts pointer to hash element RHASH_ELEM into a pointer to
+ * the structure that RHASH_ELEM is embedded inside.  Supply the
+ * name of the outer structure STRUCT and the member name MEMBER
+ * of the hash element. */
+#define rhash_entry(RHASH_ELEM, STRUCT, MEMBER)                 \
+	((STRUCT *) ((uint8_t *) (RHASH_ELEM)                   \
+		- offsetof (STRUCT, MEMBER)))
+
+/* Computes and returns the hash value for hash element E, given
+ * auxiliary data AUX. */
+typedef uint64_t rhash_hash_func (const struct rhash_elem *e, void *aux);
+
+/* Compares the value of two hash elements A and B, given
+ * auxiliary data AUX.  Returns true if A is less than B, or
+ * false if A is greater than or equal to B. */
+typedef bool rhash_less_func (const struct rhash_elem *a,
+		const struct rhash_elem *b,
+		void *aux);
+
+/* Performs some operation on hash element E, given auxiliary
+ * data AUX. */
+typedef void rhash_action_func (struct rhash_elem *e, void *aux);
+
+/* One slot of the table. */
+struct rhash_slot {
+	uint64_t hash;              /* Hash value of ELEM. */
+	struct rhash_elem *elem;    /* Element, or a null pointer if empty. */
+};
+
+/* Hash table. */
+struct rhash {
+	size_t elem_cnt;            /* Number of elements in table. */
+	struct rhash_slot *slots;   /* Array of `slot_cnt' slots. */
+	size_t slot_cnt;            /* Number of slots, a power of 2. */
+	size_t used_cnt;            /* Number of elements in `slots'. */
+	struct rhash_slot *old_slots; /* Array being drained, or NULL. */
+	size_t old_slot_cnt;        /* Number of slots in `old_slots'. */
+	size_t old_pos;             /* Next slot of `old_slots' to move. */
+	rhash_hash_func *hash;      /* Hash function. */
+	rhash_less_func *less;      /* Comparison function. */
+	void *aux;                  /* Auxiliary data for `hash' and `less'. */
+};
+
+/* A hash table iterator. */
+struct rhash_iterator {
+	struct rhash *hash;         /* The hash table. */
+	struct rhash_slot *slot;    /* Current slot. */
+	struct rhash_elem *elem;    /* Current hash element. */
+};
+
+/* Basic life cycle. */
+bool rhash_init (struct rhash *, rhash_hash_func *, rhash_less_func *,
+		void *aux);
+void rhash_clear (struct rhash *, rhash_action_func *);
+void rhash_destroy (struct rhash *, rhash_action_func *);
+
+/* Search, insertion, deletion. */
+struct rhash_elem *rhash_insert (struct rhash *, struct rhash_elem *);
+struct rhash_elem *rhash_find (struct rhash *, struct rhash_elem *);
+struct rhash_elem *rhash_delete (struct rhash *, struct rhash_elem *);
+
+/* Iteration. */
+void rhash_first (struct rhash_iterator *, struct rhash *);
+struct rhash_elem *rhash_next (struct rhash_iterator *);
+struct rhash_elem *rhash_cur (struct rhash_iterator *);
+
+/* Information. */
+size_t rhash_size (struct rhash *);
+bool rhash_empty (struct rhash *);
+
+#endif /* lib/kernel/rhash.h */
@@ -36,6 +36,24 @@ enum {
 
 	SYS_MOUNT,
 	SYS_UMOUNT,
+
+	/* File system extensions. */
+	SYS_ALLOCATED_RANGE,        /* Find allocated data in a sparse file. */
+	SYS_FSYNC,                  /* Force a file to disk. */
+	SYS_FDATASYNC,              /* Force a file's data to disk. */
+	SYS_SYNC,                   /* Force all files to disk. */
+	SYS_DISK_STATS,             /* Read a disk's I/O statistics. */
+	SYS_TICKS,                  /* Timer ticks since boot. */
+	SYS_OPEN_FLAGS,             /* Open a file with flags. */
+	SYS_SET_COMPRESSED,         /* Store a file compressed. */
+	SYS_CLONE,                  /* Copy a file by sharing its sectors. */
+	SYS_GETDENTS,               /* Read many directory entries. */
+	SYS_FALLOCATE,              /* Reserve disk space for a file. */
+	SYS_DEFRAG,                 /* Defragment the file system. */
+	SYS_DMESG,                  /* Read the kernel log. */
 };
 
+/* Flags for SYS_OPEN_FLAGS. */
+#define O_DIRECT 0x1                /* Bypass the buffer cache. */
+
 #endif /* lib/syscall-nr.h */
@@ -2,6 +2,10 @@
 #define __LIB_USER_SYSCALL_H
 
 #include <stdbool.h>
+#include <dirent.h>
+#include <disk-stats.h>
+#include <frag-stats.h>
+#include <syscall-nr.h>
 #include <debug.h>
 #include <stddef.h>
 
@@ -50,6 +54,21 @@ bool isdir (int fd);
 int inumber (int fd);
 int symlink (const char* target, const char* linkpath);
 
+/* File system extensions. */
+bool allocated_range (int fd, unsigned offset, unsigned *start, unsigned *length);
+int fsync (int fd);
+int fdatasync (int fd);
+void sync (void);
+bool disk_stats (int chan_no, int dev_no, enum disk_class class, bool write, struct disk_stats *stats);
+long long ticks (void);
+int open_flags (const char *file, int flags);
+bool set_compressed (int fd);
+bool clone (const char *file, const char *new_file);
+int getdents (const char *dir, unsigned *pos, struct dirent *ents, unsigned cnt);
+bool fallocate (int fd, unsigned offset, unsigned length);
+int defrag (struct frag_stats *before, struct frag_stats *after);
+int dmesg (char *buffer, unsigned size);
+
 static inline void* get_phys_addr (void *user_addr) {
 	void* pa;
 	asm volatile ("movq %0, %%rax" ::"r"(user_addr));
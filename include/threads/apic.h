@@ -0,0 +1,17 @@
+#ifndef THREADS_APIC_H
+#define THREADS_APIC_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Set by the -apic kernel option to use the APICs in place of the
+   8259 PICs. */
+extern bool apic_requested;
+
+void apic_init (void);
+bool apic_enabled (void);
+void apic_end_of_interrupt (void);
+void apic_set_level_triggered (int irq);
+bool apic_timer_start (uint8_t vec_no, int freq);
+
+#endif /* threads/apic.h */
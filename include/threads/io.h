@@ -119,7 +119,7 @@ outsb (uint16_t port, const void *addr, size_t cnt) {
 	asm volatile ("cld; repne; outsb"
 			: "=S" (addr), "=c" (cnt)
 			: "d" (port), "0" (addr), "1" (cnt)
-			: "cc");
+			: "memory", "cc");
 }
 
 /* Writes the 16-bit DATA to PORT. */
@@ -137,7 +137,7 @@ outsw (uint16_t port, const void *addr, size_t cnt) {
 	asm volatile ("cld; repne; outsw"
 			: "=S" (addr), "=c" (cnt)
 			: "d" (port), "0" (addr), "1" (cnt)
-			: "cc");
+			: "memory", "cc");
 }
 
 /* Writes the 32-bit DATA to PORT. */
@@ -155,7 +155,7 @@ outsl (uint16_t port, const void *addr, size_t cnt) {
 	asm volatile ("cld; repne; outsl"
 			: "=S" (addr), "=c" (cnt)
 			: "d" (port), "0" (addr), "1" (cnt)
-			: "cc");
+			: "memory", "cc");
 }
 
 #endif /* threads/io.h */
@@ -9,6 +9,8 @@ enum vm_type;
 struct anon_page {
     enum vm_type type;        /* Page type that include VM_MARKER. */
     disk_sector_t sec_no;     /* Index of a disk sector that save page swapped out. */
+    bool writing;             /* 1: SWAP_WRITE was submitted and not yet waited for. */
+    struct disk_request swap_write;   /* Asynchronous write of the page to swap. */
 };
 
 void vm_anon_init (void);
@@ -2,7 +2,7 @@
 #define VM_VM_H
 #include <stdbool.h>
 #include "threads/palloc.h"
-#include "lib/kernel/hash.h"
+#include "lib/kernel/rhash.h"
 #include "threads/mmu.h"
 
 enum vm_type {
@@ -45,7 +45,7 @@ struct page {
 	void *va;                                  /* Address in terms of user space(virtual page). */
 	struct frame *frame;                       /* Back reference for frame(page frame). */
 
-	struct hash_elem hash_elem;                /* Hash table element. */
+	struct rhash_elem hash_elem;               /* Hash table element. */
 	bool writable;                             /* 1: writable, 0: read-only. */
 	struct list_elem mp_elem;                  /* List element of 'mmap_page_list' */
 	struct thread *owner;                      /* Thread that own(made) the page. */
@@ -67,6 +67,7 @@ struct frame {
 	void *kva;                                 /* Kernel virtual address(mapped one-to-one to physical memory). */
 	struct page *page;                         /* Page struct include page va allocated to frame. */
 	struct list_elem f_elem;                   /* List element of frame table('frames'). */
+	bool pinned;                               /* 1: not to be evicted: pinned for I/O or already chosen as a victim. */
 };
 
 /* The function table for page operations.
@@ -89,7 +90,7 @@ struct page_operations {
  * We don't want to force you to obey any specific design for this struct.
  * All designs up to you for this. */
 struct supplemental_page_table {
-	struct hash pages;                         /* Hash table that include pages allocated. */
+	struct rhash pages;                        /* Hash table that include pages allocated. */
 	struct list mmap_file_list;                /* Lisf of file-backed pages returned by mmap function. */
 };
 
@@ -122,6 +123,8 @@ bool vm_alloc_page_with_initializer (enum vm_type type, void *upage,
 		bool writable, vm_initializer *init, void *aux);
 void vm_dealloc_page (struct page *page);
 bool vm_claim_page (void *va);
+void *vm_pin_page (void *uaddr, bool write);
+void vm_unpin_page (void *uaddr);
 enum vm_type page_get_type (struct page *page);
 
 #endif  /* VM_VM_H */
@@ -63,6 +63,40 @@ last_mask (const struct bitmap *b) {
 	return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns the number of bits set in E.  (__builtin_popcountl()
+   would call into libgcc, which the kernel does not link.) */
+static inline size_t
+elem_popcount (elem_type e) {
+	e = e - ((e >> 1) & 0x5555555555555555UL);
+	e = (e & 0x3333333333333333UL) + ((e >> 2) & 0x3333333333333333UL);
+	e = (e + (e >> 4)) & 0x0f0f0f0f0f0f0f0fUL;
+	return (e * 0x0101010101010101UL) >> 56;
+}
+
+/* Returns the number of consecutive bits in B, starting at
+   BIT_IDX and going no further than the end of its element or of
+   B, that are set to VALUE. */
+static size_t
+run_length (const struct bitmap *b, size_t bit_idx, bool value) {
+	size_t ofs = bit_idx % ELEM_BITS;
+	size_t avail = ELEM_BITS - ofs;
+	elem_type other;
+
+	if (avail > b->bit_cnt - bit_idx)
+		avail = b->bit_cnt - bit_idx;
+
+	/* Bits not set to VALUE, shifted down so that BIT_IDX is bit 0. */
+	other = b->bits[elem_idx (bit_idx)];
+	if (value)
+		other = ~other;
+	other >>= ofs;
+
+	if (other == 0)
+		return avail;
+	return (size_t) __builtin_ctzl (other) < avail
+		? (size_t) __builtin_ctzl (other) : avail;
+}
+
 /* Creation and destruction. */
 
 /* Initializes B to be a bitmap of BIT_CNT bits
@@ -147,7 +181,7 @@ bitmap_mark (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] |= mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the OR instruction in [IA32-v2b]. */
-	asm ("lock orq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	asm ("lock orq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Atomically sets the bit numbered BIT_IDX in B to false. */
@@ -159,7 +193,7 @@ bitmap_reset (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] &= ~mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the AND instruction in [IA32-v2a]. */
-	asm ("lock andq %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+	asm ("lock andq %1, %0" : "+m" (b->bits[idx]) : "r" (~mask) : "cc");
 }
 
 /* Atomically toggles the bit numbered IDX in B;
@@ -173,7 +207,7 @@ bitmap_flip (struct bitmap *b, size_t bit_idx) {
 	/* This is equivalent to `b->bits[idx] ^= mask' except that it
 	   is guaranteed to be atomic on a uniprocessor machine.  See
 	   the description of the XOR instruction in [IA32-v2b]. */
-	asm ("lock xorq %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+	asm ("lock xorq %1, %0" : "+m" (b->bits[idx]) : "r" (mask) : "cc");
 }
 
 /* Returns the value of the bit numbered IDX in B. */
@@ -211,32 +245,44 @@ bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) {
    exclusive, that are set to VALUE. */
 size_t
 bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i, value_cnt;
+	size_t set_cnt, left;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	value_cnt = 0;
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
-			value_cnt++;
-	return value_cnt;
+	/* Count set bits an element at a time. */
+	set_cnt = 0;
+	for (left = cnt; left > 0; ) {
+		size_t ofs = start % ELEM_BITS;
+		size_t n = ELEM_BITS - ofs < left ? ELEM_BITS - ofs : left;
+		elem_type e = b->bits[elem_idx (start)] >> ofs;
+
+		if (n < ELEM_BITS)
+			e &= ((elem_type) 1 << n) - 1;
+		set_cnt += elem_popcount (e);
+		start += n;
+		left -= n;
+	}
+	return value ? set_cnt : cnt - set_cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
    exclusive, are set to VALUE, and false otherwise. */
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) {
-	size_t i;
+	size_t i, n;
 
 	ASSERT (b != NULL);
 	ASSERT (start <= b->bit_cnt);
 	ASSERT (start + cnt <= b->bit_cnt);
 
-	for (i = 0; i < cnt; i++)
-		if (bitmap_test (b, start + i) == value)
+	/* Skip over runs of !VALUE an element at a time. */
+	for (i = 0; i < cnt; i += n) {
+		n = run_length (b, start + i, !value);
+		if (n == 0)
 			return true;
+	}
 	return false;
 }
 
@@ -266,7 +312,12 @@ bitmap_all (const struct bitmap *b, size_t start, size_t cnt) {
 /* Finds and returns the starting index of the first group of CNT
    consecutive bits in B at or after START that are all set to
    VALUE.
-   If there is no such group, returns BITMAP_ERROR. */
+   If there is no such group, returns BITMAP_ERROR.
+
+   Works an element at a time: a run of bits that match, or that
+   don't, is measured with a single count-trailing-zeros, so the
+   cost grows with the number of elements and runs examined, not
+   with bits times CNT. */
 size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 	ASSERT (b != NULL);
@@ -274,14 +325,47 @@ bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) {
 
 	if (cnt <= b->bit_cnt) {
 		size_t last = b->bit_cnt - cnt;
-		size_t i;
-		for (i = start; i <= last; i++)
-			if (!bitmap_contains (b, i, cnt, !value))
+		size_t i = start;       /* Start of the group being grown. */
+		size_t len = 0;         /* Bits set to VALUE from I on. */
+
+		while (i <= last) {
+			size_t n;
+
+			if (len >= cnt)
 				return i;
+			n = run_length (b, i + len, value);
+			if (n > 0)
+				len += n;
+			else {
+				/* The group is broken: start again past the bits
+				   that aren't VALUE. */
+				i += len + run_length (b, i + len, !value);
+				len = 0;
+			}
+		}
 	}
 	return BITMAP_ERROR;
 }
 
+/* Like bitmap_scan(), but starts looking at HINT, say just past
+   the group found last time, and wraps around to the beginning of
+   B if need be, so that a caller allocating one group after
+   another need not step over all the earlier ones each time. */
+size_t
+bitmap_scan_hint (const struct bitmap *b, size_t hint, size_t cnt,
+		bool value) {
+	size_t idx;
+
+	ASSERT (b != NULL);
+
+	if (hint > b->bit_cnt)
+		hint = 0;
+	idx = bitmap_scan (b, hint, cnt, value);
+	if (idx == BITMAP_ERROR && hint > 0)
+		idx = bitmap_scan (b, 0, cnt, value);
+	return idx;
+}
+
 /* Finds the first group of CNT consecutive bits in B at or after
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
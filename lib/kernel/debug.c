@@ -1,5 +1,6 @@
 #include <debug.h>
 #include <console.h>
+#include <klog.h>
 #include <stdarg.h>
 #include <stdbool.h>
 #include <stddef.h>
@@ -22,6 +23,7 @@ debug_panic (const char *file, int line, const char *function,
 
 	level++;
 	if (level == 1) {
+		klog_flush ();
 		printf ("Kernel PANIC at %s:%d in %s(): ", file, line, function);
 
 		va_start (args, message);
@@ -0,0 +1,228 @@
+#include <klog.h>
+#include <inttypes.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+
+/* Kernel log.
+
+   klog() formats a message into the next record of an in-memory
+   ring and returns, without taking any lock or touching the
+   console, so it is cheap enough for hot paths and safe in
+   interrupt handlers.  A writer claims its record by atomically
+   bumping the sequence counter, and publishes it by storing the
+   record's sequence number last; readers check that number
+   before and after copying the record, so a record overwritten
+   under them is noticed and skipped.
+
+   Messages at klog_console_level or more severe are also printed
+   to the console, later, by the "klogd" thread, at most
+   KLOG_BURST of them every KLOG_INTERVAL ticks.  The rest of a
+   burst stays in the ring, where klog_read() (and the dmesg
+   system call) can still find it.  klog_flush() prints whatever
+   klogd has not got to yet, at power off and on panic. */
+
+/* Number of records in the ring. */
+#define KLOG_CNT 256
+
+/* Longest message kept, including the null terminator. */
+#define KLOG_MSG_MAX 104
+
+/* Console rate limit. */
+#define KLOG_INTERVAL TIMER_FREQ
+#define KLOG_BURST 10
+
+/* A logged message. */
+struct klog_record {
+	uint64_t seq;               /* Sequence number, 0 while written. */
+	int64_t ticks;              /* Timer ticks when logged. */
+	enum klog_level level;      /* Severity. */
+	char msg[KLOG_MSG_MAX];     /* Null-terminated message. */
+};
+
+static struct klog_record ring[KLOG_CNT];
+
+/* Sequence number of the next record written.  Numbering starts
+   at 1, so that an unused record is never mistaken for one. */
+static uint64_t next_seq = 1;
+
+enum klog_level klog_console_level = KLOG_WARN;
+
+/* Console output, done by klogd. */
+static struct semaphore drain_wait; /* Up'd for a console message. */
+static bool drain_started;          /* klogd is running? */
+static uint64_t drain_seq = 1;      /* Next record to consider. */
+static int64_t burst_start;         /* Ticks when the burst began. */
+static int burst_cnt;               /* Messages printed in the burst. */
+static long long suppressed_cnt;    /* Messages withheld by the limit. */
+
+static const char *level_names[KLOG_LEVEL_CNT] = {
+	[KLOG_ERR] = "err",
+	[KLOG_WARN] = "warn",
+	[KLOG_INFO] = "info",
+	[KLOG_DEBUG] = "debug",
+};
+
+static thread_func klogd;
+
+/* Starts the thread that prints log messages to the console.
+   Messages logged earlier are kept until then. */
+void
+klog_init (void) {
+	sema_init (&drain_wait, 0);
+	drain_started = true;
+	thread_create ("klogd", PRI_MIN, klogd, NULL);
+	sema_up (&drain_wait);
+}
+
+/* Logs a message with severity LEVEL, formatted as by printf().
+   May be called from any context, including interrupt handlers. */
+void
+klog (enum klog_level level, const char *format, ...) {
+	uint64_t seq = __atomic_fetch_add (&next_seq, 1, __ATOMIC_RELAXED);
+	struct klog_record *r = &ring[seq % KLOG_CNT];
+	va_list args;
+
+	ASSERT ((unsigned) level < KLOG_LEVEL_CNT);
+
+	__atomic_store_n (&r->seq, 0, __ATOMIC_RELAXED);
+	__atomic_thread_fence (__ATOMIC_RELEASE);
+	r->ticks = timer_ticks ();
+	r->level = level;
+	va_start (args, format);
+	vsnprintf (r->msg, sizeof r->msg, format, args);
+	va_end (args);
+	__atomic_store_n (&r->seq, seq, __ATOMIC_RELEASE);
+
+	if (level <= klog_console_level && drain_started)
+		sema_up (&drain_wait);
+}
+
+/* Copies record SEQ into *R.  Returns false if it was
+   overwritten or is still being written. */
+static bool
+read_record (uint64_t seq, struct klog_record *r) {
+	const struct klog_record *slot = &ring[seq % KLOG_CNT];
+
+	if (__atomic_load_n (&slot->seq, __ATOMIC_ACQUIRE) != seq)
+		return false;
+	memcpy (r, slot, sizeof *r);
+	__atomic_thread_fence (__ATOMIC_ACQUIRE);
+	return __atomic_load_n (&slot->seq, __ATOMIC_RELAXED) == seq;
+}
+
+/* Formats record SEQ as a line of dmesg output into LINE, which
+   has room for SIZE bytes.  Returns the line's length, or -1 if
+   the record is gone. */
+static int
+format_record (uint64_t seq, char *line, size_t size) {
+	struct klog_record r;
+	int len;
+
+	if (!read_record (seq, &r))
+		return -1;
+	r.msg[KLOG_MSG_MAX - 1] = '\0';
+	len = snprintf (line, size, "[%8"PRId64"] %s: %s\n",
+			r.ticks, level_names[r.level], r.msg);
+	return (size_t) len < size ? len : (int) size - 1;
+}
+
+/* Prints the console messages logged since the last call.  If
+   LIMIT is true, stops printing for the rest of a burst once it
+   has printed KLOG_BURST messages. */
+static void
+drain (bool limit) {
+	uint64_t end = __atomic_load_n (&next_seq, __ATOMIC_ACQUIRE);
+	struct klog_record r;
+
+	if (end - drain_seq > KLOG_CNT)
+		drain_seq = end - KLOG_CNT;
+	for (; drain_seq < end; drain_seq++) {
+		if (!read_record (drain_seq, &r)) {
+			/* Still being written: klog() wakes us again once it
+			   is done.  Otherwise it's gone, so go on. */
+			if (__atomic_load_n (&ring[drain_seq % KLOG_CNT].seq,
+						__ATOMIC_RELAXED) == 0)
+				break;
+			continue;
+		}
+		if (r.level > klog_console_level)
+			continue;
+
+		if (limit) {
+			if (timer_elapsed (burst_start) >= KLOG_INTERVAL) {
+				if (suppressed_cnt > 0)
+					printf ("klog: %lld messages suppressed\n", suppressed_cnt);
+				burst_start = timer_ticks ();
+				burst_cnt = 0;
+				suppressed_cnt = 0;
+			}
+			if (burst_cnt >= KLOG_BURST) {
+				suppressed_cnt++;
+				continue;
+			}
+			burst_cnt++;
+		}
+		r.msg[KLOG_MSG_MAX - 1] = '\0';
+		printf ("%s\n", r.msg);
+	}
+}
+
+/* Thread function for klogd, which prints console messages as
+   klog() signals them. */
+static void
+klogd (void *aux UNUSED) {
+	for (;;) {
+		sema_down (&drain_wait);
+		drain (true);
+	}
+}
+
+/* Prints every console message not printed yet, regardless of
+   the rate limit, for when klogd will not get another chance. */
+void
+klog_flush (void) {
+	enum intr_level old_level = intr_disable ();
+	drain (false);
+	intr_set_level (old_level);
+}
+
+/* Copies the newest log messages that fit into BUFFER, which has
+   room for SIZE bytes, oldest first, one line each, and returns
+   the number of bytes copied.  The buffer is not null-terminated. */
+size_t
+klog_read (char *buffer, size_t size) {
+	uint64_t end = __atomic_load_n (&next_seq, __ATOMIC_ACQUIRE);
+	uint64_t first = end > KLOG_CNT ? end - KLOG_CNT : 1;
+	uint64_t seq;
+	char line[KLOG_MSG_MAX + 32];
+	size_t total;
+	int len;
+
+	/* Find the oldest message from which on the rest fit. */
+	total = 0;
+	for (seq = end; seq > first; seq--) {
+		len = format_record (seq - 1, line, sizeof line);
+		if (len < 0)
+			continue;
+		if (total + len > size)
+			break;
+		total += len;
+	}
+
+	total = 0;
+	for (; seq < end; seq++) {
+		len = format_record (seq, line, sizeof line);
+		if (len < 0 || total + len > size)
+			continue;
+		memcpy (buffer + total, line, len);
+		total += len;
+	}
+	return total;
+}
@@ -0,0 +1,419 @@
+/* Open-addressing hash table.
+
+   See rhash.h for basic information. */
+
+#include "rhash.h"
+#include "../debug.h"
+#include "threads/malloc.h"
+
+/* Slot counts. */
+#define MIN_SLOTS 16            /* Never fewer slots than this. */
+
+/* Load limits, in elements per 8 slots. */
+#define MAX_LOAD 6              /* Grow beyond 3/4 full. */
+#define MIN_LOAD 1              /* Shrink below 1/8 full. */
+
+/* Number of old slots moved to the new array by each insertion
+   or deletion while the table is being resized.  Growing starts
+   with the old array 3/4 full and the new one twice its size, so
+   anything over 2 drains the old array before the new one fills
+   up. */
+#define MOVE_SLOTS 8
+
+/* Marks a slot in the old array whose element has been moved or
+   deleted.  Unlike an empty slot, it does not end a search, and
+   it keeps its hash value so that the Robin Hood early exit
+   still works. */
+static struct rhash_elem moved;
+
+static uint64_t hash_of (struct rhash *, struct rhash_elem *);
+static struct rhash_slot *find_slot (struct rhash *, struct rhash_slot *,
+		size_t slot_cnt, uint64_t hash, struct rhash_elem *);
+static void insert_slot (struct rhash *, uint64_t, struct rhash_elem *);
+static void remove_slot (struct rhash *, struct rhash_slot *);
+static void move_old (struct rhash *, size_t slot_cnt);
+static bool resize (struct rhash *, size_t slot_cnt);
+
+/* Initializes hash table H to compute hash values using HASH and
+   compare hash elements using LESS, given auxiliary data AUX. */
+bool
+rhash_init (struct rhash *h,
+		rhash_hash_func *hash, rhash_less_func *less, void *aux) {
+	h->elem_cnt = 0;
+	h->slot_cnt = MIN_SLOTS;
+	h->slots = calloc (h->slot_cnt, sizeof *h->slots);
+	h->used_cnt = 0;
+	h->old_slots = NULL;
+	h->old_slot_cnt = 0;
+	h->old_pos = 0;
+	h->hash = hash;
+	h->less = less;
+	h->aux = aux;
+
+	return h->slots != NULL;
+}
+
+/* Removes all the elements from H.
+
+   If DESTRUCTOR is non-null, then it is called for each element
+   in the hash.  DESTRUCTOR may, if appropriate, deallocate the
+   memory used by the hash element.  However, modifying hash
+   table H while rhash_clear() is running, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(), or
+   rhash_delete(), yields undefined behavior, whether done in
+   DESTRUCTOR or elsewhere. */
+void
+rhash_clear (struct rhash *h, rhash_action_func *destructor) {
+	size_t i;
+
+	if (destructor != NULL) {
+		struct rhash_iterator it;
+
+		rhash_first (&it, h);
+		while (rhash_next (&it))
+			destructor (rhash_cur (&it), h->aux);
+	}
+
+	free (h->old_slots);
+	h->old_slots = NULL;
+	h->old_slot_cnt = 0;
+	h->old_pos = 0;
+	for (i = 0; i < h->slot_cnt; i++)
+		h->slots[i].elem = NULL;
+	h->used_cnt = 0;
+	h->elem_cnt = 0;
+}
+
+/* Destroys hash table H.
+
+   If DESTRUCTOR is non-null, then it is first called for each
+   element in the hash, as in rhash_clear(). */
+void
+rhash_destroy (struct rhash *h, rhash_action_func *destructor) {
+	if (destructor != NULL)
+		rhash_clear (h, destructor);
+	free (h->old_slots);
+	free (h->slots);
+	h->old_slots = h->slots = NULL;
+}
+
+/* Inserts NEW into hash table H and returns a null pointer, if
+   no equal element is already in the table.
+   If an equal element is already in the table, returns it
+   without inserting NEW.
+   If the table is full and cannot be grown for lack of memory,
+   returns NEW itself without inserting it. */
+struct rhash_elem *
+rhash_insert (struct rhash *h, struct rhash_elem *new) {
+	uint64_t hash = hash_of (h, new);
+	struct rhash_slot *s;
+
+	s = find_slot (h, h->slots, h->slot_cnt, hash, new);
+	if (s == NULL && h->old_slots != NULL)
+		s = find_slot (h, h->old_slots, h->old_slot_cnt, hash, new);
+	if (s != NULL)
+		return s->elem;
+
+	move_old (h, MOVE_SLOTS);
+	if ((h->used_cnt + 1) * 8 > h->slot_cnt * MAX_LOAD) {
+		/* Start growing.  Elements still waiting in the old array
+		   are moved first; they always fit, because MOVE_SLOTS
+		   empties the old array well before this point. */
+		move_old (h, h->old_slot_cnt);
+		if (!resize (h, h->slot_cnt * 2) && h->used_cnt + 1 >= h->slot_cnt)
+			return new;
+	}
+
+	insert_slot (h, hash, new);
+	h->elem_cnt++;
+	return NULL;
+}
+
+/* Finds and returns an element equal to E in hash table H, or a
+   null pointer if no equal element exists in the table.
+   Does not modify H. */
+struct rhash_elem *
+rhash_find (struct rhash *h, struct rhash_elem *e) {
+	uint64_t hash = hash_of (h, e);
+	struct rhash_slot *s;
+
+	s = find_slot (h, h->slots, h->slot_cnt, hash, e);
+	if (s == NULL && h->old_slots != NULL)
+		s = find_slot (h, h->old_slots, h->old_slot_cnt, hash, e);
+	return s != NULL ? s->elem : NULL;
+}
+
+/* Finds, removes, and returns an element equal to E in hash
+   table H.  Returns a null pointer if no equal element existed
+   in the table.
+
+   If the elements of the hash table are dynamically allocated,
+   or own resources that are, then it is the caller's
+   responsibility to deallocate them. */
+struct rhash_elem *
+rhash_delete (struct rhash *h, struct rhash_elem *e) {
+	uint64_t hash = hash_of (h, e);
+	struct rhash_elem *found = NULL;
+	struct rhash_slot *s;
+
+	s = find_slot (h, h->slots, h->slot_cnt, hash, e);
+	if (s != NULL) {
+		found = s->elem;
+		remove_slot (h, s);
+	} else if (h->old_slots != NULL) {
+		s = find_slot (h, h->old_slots, h->old_slot_cnt, hash, e);
+		if (s != NULL) {
+			found = s->elem;
+			s->elem = &moved;
+		}
+	}
+	if (found == NULL)
+		return NULL;
+	h->elem_cnt--;
+
+	move_old (h, MOVE_SLOTS);
+	if (h->old_slots == NULL && h->slot_cnt > MIN_SLOTS
+			&& h->elem_cnt * 8 < h->slot_cnt * MIN_LOAD) {
+		/* Shrink to about 1/4 full, leaving room to grow again
+		   before the old array has been drained. */
+		size_t slot_cnt = MIN_SLOTS;
+		while (slot_cnt < h->elem_cnt * 4)
+			slot_cnt *= 2;
+		resize (h, slot_cnt);
+	}
+	return found;
+}
+
+/* Initializes I for iterating hash table H.
+
+   Iteration idiom:
+
+   struct rhash_iterator i;
+
+   rhash_first (&i, h);
+   while (rhash_next (&i))
+   {
+   struct foo *f = rhash_entry (rhash_cur (&i), struct foo, elem);
+   ...do something with f...
+   }
+
+   Modifying hash table H during iteration, using any of the
+   functions rhash_clear(), rhash_destroy(), rhash_insert(), or
+   rhash_delete(), invalidates all iterators. */
+void
+rhash_first (struct rhash_iterator *i, struct rhash *h) {
+	ASSERT (i != NULL);
+	ASSERT (h != NULL);
+
+	i->hash = h;
+	i->slot = NULL;
+	i->elem = NULL;
+}
+
+/* Advances I to the next element in the hash table and returns
+   it.  Returns a null pointer if no elements are left.  Elements
+   are returned in arbitrary order. */
+struct rhash_elem *
+rhash_next (struct rhash_iterator *i) {
+	struct rhash *h;
+
+	ASSERT (i != NULL);
+
+	/* Visit the old array, if any, then the current one. */
+	h = i->hash;
+	for (;;) {
+		if (i->slot == NULL)
+			i->slot = h->old_slots != NULL ? h->old_slots : h->slots;
+		else if (h->old_slots != NULL
+				&& i->slot + 1 == h->old_slots + h->old_slot_cnt)
+			i->slot = h->slots;
+		else if (i->slot + 1 == h->slots + h->slot_cnt) {
+			i->elem = NULL;
+			break;
+		} else
+			i->slot++;
+
+		if (i->slot->elem != NULL && i->slot->elem != &moved) {
+			i->elem = i->slot->elem;
+			break;
+		}
+	}
+
+	return i->elem;
+}
+
+/* Returns the current element in the hash table iteration, or a
+   null pointer at the end of the table.  Undefined behavior
+   after calling rhash_first() but before rhash_next(). */
+struct rhash_elem *
+rhash_cur (struct rhash_iterator *i) {
+	return i->elem;
+}
+
+/* Returns the number of elements in H. */
+size_t
+rhash_size (struct rhash *h) {
+	return h->elem_cnt;
+}
+
+/* Returns true if H contains no elements, false otherwise. */
+bool
+rhash_empty (struct rhash *h) {
+	return h->elem_cnt == 0;
+}
+
+/* Returns the hash value of E in H.
+
+   The slot index is taken from the low bits of the hash value,
+   but hash functions such as hash_bytes() leave those bits
+   depending on only the low bits of each input byte, so that,
+   for example, addresses of neighbouring pages would pile up in
+   a few slots.  The hash function's result is therefore mixed
+   with the finalizer from MurmurHash3 first. */
+static uint64_t
+hash_of (struct rhash *h, struct rhash_elem *e) {
+	uint64_t x = h->hash (e, h->aux);
+
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdUL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53UL;
+	x ^= x >> 33;
+	return x;
+}
+
+/* Returns how far slot IDX, holding an element with hash value
+   HASH, is from that element's home slot in an array of SLOT_CNT
+   slots. */
+static inline size_t
+distance (size_t idx, uint64_t hash, size_t slot_cnt) {
+	return (idx - hash) & (slot_cnt - 1);
+}
+
+/* Searches the SLOT_CNT slots in SLOTS, an array belonging to H,
+   for an element equal to E, whose hash value is HASH.  Returns
+   its slot if found or a null pointer otherwise. */
+static struct rhash_slot *
+find_slot (struct rhash *h, struct rhash_slot *slots, size_t slot_cnt,
+		uint64_t hash, struct rhash_elem *e) {
+	size_t d;
+
+	for (d = 0; d < slot_cnt; d++) {
+		size_t idx = (hash + d) & (slot_cnt - 1);
+		struct rhash_slot *s = &slots[idx];
+
+		/* Every element that hashes where E does lies before the
+		   first empty slot, and before any element that is
+		   closer to its own home slot than E would be. */
+		if (s->elem == NULL || distance (idx, s->hash, slot_cnt) < d)
+			break;
+		if (s->hash == hash && s->elem != &moved
+				&& !h->less (s->elem, e, h->aux)
+				&& !h->less (e, s->elem, h->aux))
+			return s;
+	}
+	return NULL;
+}
+
+/* Inserts element E, whose hash value is HASH, into H's current
+   slot array, which must have an empty slot. */
+static void
+insert_slot (struct rhash *h, uint64_t hash, struct rhash_elem *e) {
+	struct rhash_slot cur = { .hash = hash, .elem = e };
+	size_t idx = hash & (h->slot_cnt - 1);
+	size_t d = 0;
+
+	ASSERT (h->used_cnt < h->slot_cnt);
+
+	for (;;) {
+		struct rhash_slot *s = &h->slots[idx];
+		size_t sd;
+
+		if (s->elem == NULL) {
+			*s = cur;
+			break;
+		}
+
+		/* Take the slot from an element closer to home, and go on
+		   looking for a place for that one instead. */
+		sd = distance (idx, s->hash, h->slot_cnt);
+		if (sd < d) {
+			struct rhash_slot tmp = *s;
+			*s = cur;
+			cur = tmp;
+			d = sd;
+		}
+		idx = (idx + 1) & (h->slot_cnt - 1);
+		d++;
+	}
+	h->used_cnt++;
+}
+
+/* Removes the element in slot S of H's current slot array,
+   shifting the elements after it back so that no search that
+   should reach them is stopped short. */
+static void
+remove_slot (struct rhash *h, struct rhash_slot *s) {
+	size_t idx = s - h->slots;
+
+	for (;;) {
+		size_t next = (idx + 1) & (h->slot_cnt - 1);
+		struct rhash_slot *n = &h->slots[next];
+
+		if (n->elem == NULL || distance (next, n->hash, h->slot_cnt) == 0)
+			break;
+		h->slots[idx] = *n;
+		idx = next;
+	}
+	h->slots[idx].elem = NULL;
+	h->used_cnt--;
+}
+
+/* Moves the elements in up to SLOT_CNT slots of H's old slot
+   array into the current one, and frees the old array once it
+   has all been moved. */
+static void
+move_old (struct rhash *h, size_t slot_cnt) {
+	if (h->old_slots == NULL)
+		return;
+
+	for (; slot_cnt > 0 && h->old_pos < h->old_slot_cnt; slot_cnt--) {
+		struct rhash_slot *s = &h->old_slots[h->old_pos++];
+		if (s->elem != NULL && s->elem != &moved) {
+			insert_slot (h, s->hash, s->elem);
+			s->elem = &moved;
+		}
+	}
+
+	if (h->old_pos == h->old_slot_cnt) {
+		free (h->old_slots);
+		h->old_slots = NULL;
+		h->old_slot_cnt = 0;
+		h->old_pos = 0;
+	}
+}
+
+/* Starts moving H's elements into a new array of SLOT_CNT slots,
+   which must not already be under way.  Returns false if memory
+   for the new array cannot be allocated, in which case H is
+   unchanged and still usable, just more crowded than it should
+   be. */
+static bool
+resize (struct rhash *h, size_t slot_cnt) {
+	struct rhash_slot *slots;
+
+	ASSERT (h->old_slots == NULL);
+	ASSERT (slot_cnt > h->elem_cnt);
+
+	slots = calloc (slot_cnt, sizeof *slots);
+	if (slots == NULL)
+		return false;
+
+	h->old_slots = h->slots;
+	h->old_slot_cnt = h->slot_cnt;
+	h->old_pos = 0;
+	h->slots = slots;
+	h->slot_cnt = slot_cnt;
+	h->used_cnt = 0;
+	return true;
+}
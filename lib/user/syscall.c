@@ -194,3 +194,68 @@ int
 umount (const char *path) {
 	return syscall1 (SYS_UMOUNT, path);
 }
+
+bool
+allocated_range (int fd, unsigned offset, unsigned *start, unsigned *length) {
+	return syscall4 (SYS_ALLOCATED_RANGE, fd, offset, start, length);
+}
+
+int
+fsync (int fd) {
+	return syscall1 (SYS_FSYNC, fd);
+}
+
+int
+fdatasync (int fd) {
+	return syscall1 (SYS_FDATASYNC, fd);
+}
+
+void
+sync (void) {
+	syscall0 (SYS_SYNC);
+}
+
+bool
+disk_stats (int chan_no, int dev_no, enum disk_class class, bool write, struct disk_stats *stats) {
+	return syscall5 (SYS_DISK_STATS, chan_no, dev_no, class, write, stats);
+}
+
+long long
+ticks (void) {
+	return syscall0 (SYS_TICKS);
+}
+
+int
+open_flags (const char *file, int flags) {
+	return syscall2 (SYS_OPEN_FLAGS, file, flags);
+}
+
+bool
+set_compressed (int fd) {
+	return syscall1 (SYS_SET_COMPRESSED, fd);
+}
+
+bool
+clone (const char *file, const char *new_file) {
+	return syscall2 (SYS_CLONE, file, new_file);
+}
+
+int
+getdents (const char *dir, unsigned *pos, struct dirent *ents, unsigned cnt) {
+	return syscall4 (SYS_GETDENTS, dir, pos, ents, cnt);
+}
+
+bool
+fallocate (int fd, unsigned offset, unsigned length) {
+	return syscall3 (SYS_FALLOCATE, fd, offset, length);
+}
+
+int
+defrag (struct frag_stats *before, struct frag_stats *after) {
+	return syscall2 (SYS_DEFRAG, before, after);
+}
+
+int
+dmesg (char *buffer, unsigned size) {
+	return syscall2 (SYS_DMESG, buffer, size);
+}
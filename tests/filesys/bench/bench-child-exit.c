@@ -0,0 +1,12 @@
+/* Child process for bench-proc.
+   Exits as soon as it has been loaded. */
+
+#include "tests/lib.h"
+
+const char *test_name = "bench-child-exit";
+
+int
+main (void) 
+{
+  return 0;
+}
@@ -0,0 +1,29 @@
+/* Child process for bench-syn.
+   Reads the shared file from start to end. */
+
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/bench-syn.h"
+
+const char *test_name = "bench-child-read";
+
+static char buf[BLOCK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  size_t ofs;
+  int fd;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  CHECK ((fd = open (shared_name)) > 1, "open \"%s\"", shared_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    bench_read (fd, buf, sizeof buf);
+  close (fd);
+
+  return atoi (argv[1]);
+}
@@ -0,0 +1,34 @@
+/* Child process for bench-syn.
+   Writes a file of its own and forces it to disk. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/bench-syn.h"
+
+const char *test_name = "bench-child-write";
+
+static char buf[BLOCK_SIZE];
+
+int
+main (int argc, const char *argv[]) 
+{
+  char name[16];
+  size_t ofs;
+  int fd;
+
+  quiet = true;
+
+  CHECK (argc == 2, "argc must be 2, actually %d", argc);
+  snprintf (name, sizeof name, "out%s", argv[1]);
+  CHECK (create (name, 0), "create \"%s\"", name);
+  CHECK ((fd = open (name)) > 1, "open \"%s\"", name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    bench_write (fd, buf, sizeof buf);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", name);
+  close (fd);
+
+  return atoi (argv[1]);
+}
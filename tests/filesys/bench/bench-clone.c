@@ -0,0 +1,49 @@
+/* Copies a large file by reading and rewriting it, then by
+   cloning it, timing each. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_SIZE (256 * 1024)
+#define BLOCK_SIZE 4096
+
+static char buf[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  struct bench b;
+  size_t ofs;
+  int src, dst;
+
+  CHECK (create ("source", 0), "create \"source\"");
+  CHECK ((src = open ("source")) > 1, "open \"source\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    bench_write (src, buf, BLOCK_SIZE);
+  CHECK (fsync (src) == 0, "fsync \"source\"");
+
+  CHECK (create ("copy", 0), "create \"copy\"");
+  CHECK ((dst = open ("copy")) > 1, "open \"copy\"");
+  seek (src, 0);
+  bench_start (&b);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    {
+      bench_read (src, buf, BLOCK_SIZE);
+      bench_write (dst, buf, BLOCK_SIZE);
+    }
+  CHECK (fsync (dst) == 0, "fsync \"copy\"");
+  bench_report (&b, "copy", BLOCK_SIZE, FILE_SIZE);
+  close (dst);
+  close (src);
+
+  bench_start (&b);
+  CHECK (clone ("source", "clone"), "clone \"source\"");
+  sync ();
+  bench_report (&b, "clone", FILE_SIZE, FILE_SIZE);
+
+  CHECK (remove ("copy"), "remove \"copy\"");
+  CHECK (remove ("clone"), "remove \"clone\"");
+  CHECK (remove ("source"), "remove \"source\"");
+}
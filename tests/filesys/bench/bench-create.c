@@ -0,0 +1,47 @@
+/* Creates, writes, and then removes many small files, timing the
+   creation and removal storms separately. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_CNT 100
+#define FILE_SIZE 512
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  struct bench b;
+  char name[16];
+  int i;
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "small%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      bench_write (fd, buf, sizeof buf);
+      close (fd);
+    }
+  sync ();
+  bench_report (&b, "create", FILE_SIZE, (long long) FILE_CNT * FILE_SIZE);
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "small%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  sync ();
+  bench_report (&b, "remove", FILE_SIZE, (long long) FILE_CNT * FILE_SIZE);
+}
@@ -0,0 +1,48 @@
+/* Fills a directory with many entries and then opens them by
+   name in random order, timing the lookups. */
+
+#include <random.h>
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_CNT 200
+#define LOOKUP_CNT 400
+
+void
+test_main (void) 
+{
+  struct bench b;
+  char name[16];
+  int i;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "entry%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+
+  bench_start (&b);
+  for (i = 0; i < LOOKUP_CNT; i++) 
+    {
+      int fd;
+
+      snprintf (name, sizeof name, "entry%lu", random_ulong () % FILE_CNT);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      close (fd);
+    }
+  bench_report (&b, "dir-lookup", 0, 0);
+
+  msg ("remove %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      snprintf (name, sizeof name, "entry%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+}
@@ -0,0 +1,58 @@
+/* Grows two files at once, a block at a time in turn, then reads
+   each back sequentially.  Does this twice, first letting the
+   files allocate as they grow, then reserving their space up
+   front with fallocate(), and times the reads. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_SIZE (128 * 1024)
+#define BLOCK_SIZE 4096
+
+static char buf[BLOCK_SIZE];
+
+static void
+run (const char *name, bool reserve) 
+{
+  struct bench b;
+  size_t ofs;
+  int fd[2];
+  int i;
+
+  for (i = 0; i < 2; i++)
+    {
+      char file_name[16];
+
+      snprintf (file_name, sizeof file_name, "%s%d", name, i);
+      CHECK (create (file_name, 0), "create \"%s\"", file_name);
+      CHECK ((fd[i] = open (file_name)) > 1, "open \"%s\"", file_name);
+      if (reserve)
+        CHECK (fallocate (fd[i], 0, FILE_SIZE), "fallocate \"%s\"",
+               file_name);
+    }
+
+  for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+    for (i = 0; i < 2; i++)
+      bench_write (fd[i], buf, BLOCK_SIZE);
+  sync ();
+
+  for (i = 0; i < 2; i++)
+    {
+      seek (fd[i], 0);
+      bench_start (&b);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        bench_read (fd[i], buf, BLOCK_SIZE);
+      bench_report (&b, name, BLOCK_SIZE, FILE_SIZE);
+      close (fd[i]);
+    }
+}
+
+void
+test_main (void) 
+{
+  run ("grown", false);
+  run ("reserved", true);
+}
@@ -0,0 +1,61 @@
+/* Times process creation and page faults: forking a child and
+   waiting for it, forking a child that execs another program and
+   waiting for it, and touching each page of a large array for the
+   first time.
+
+   bench_report() counts bytes, so fork and exec are reported as
+   one-byte "blocks", which makes the bytes/s column processes per
+   second. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FORK_CNT 32
+#define EXEC_CNT 16
+#define PAGE_SIZE 4096
+#define PAGE_CNT 256
+
+static char pages[PAGE_CNT * PAGE_SIZE];
+
+/* Forks a child that runs CHILD with exec(), or just exits if
+   CHILD is null, and waits for it. */
+static void
+run_child (const char *child) 
+{
+  pid_t pid = fork ("child");
+
+  if (pid == 0)
+    {
+      if (child != NULL)
+        exec (child);
+      exit (0);
+    }
+  if (pid == PID_ERROR)
+    fail ("fork failed");
+  if (wait (pid) != 0)
+    fail ("child %d exited with an error", pid);
+}
+
+void
+test_main (void) 
+{
+  struct bench b;
+  size_t i;
+
+  bench_start (&b);
+  for (i = 0; i < FORK_CNT; i++)
+    run_child (NULL);
+  bench_report (&b, "fork", 1, FORK_CNT);
+
+  bench_start (&b);
+  for (i = 0; i < EXEC_CNT; i++)
+    run_child ("bench-child-exit");
+  bench_report (&b, "exec", 1, EXEC_CNT);
+
+  bench_start (&b);
+  for (i = 0; i < PAGE_CNT; i++)
+    pages[i * PAGE_SIZE] = 1;
+  bench_report (&b, "fault", PAGE_SIZE, sizeof pages);
+}
@@ -0,0 +1,64 @@
+/* Reads and then writes blocks at random offsets in a file, at
+   several block sizes, timing each pass. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_SIZE (512 * 1024)
+#define OP_CNT 256
+
+static char buf[4096];
+static const size_t block_sizes[] = {512, 4096};
+
+/* Seeks FD to a random multiple of BLOCK_SIZE within the file. */
+static void
+seek_random (int fd, size_t block_size) 
+{
+  seek (fd, random_ulong () % (FILE_SIZE / block_size) * block_size);
+}
+
+void
+test_main (void) 
+{
+  size_t ofs, i;
+  int fd;
+
+  CHECK (create ("rand", 0), "create \"rand\"");
+  CHECK ((fd = open ("rand")) > 1, "open \"rand\"");
+  msg ("fill \"rand\"");
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    bench_write (fd, buf, sizeof buf);
+  CHECK (fsync (fd) == 0, "fsync \"rand\"");
+
+  for (i = 0; i < sizeof block_sizes / sizeof *block_sizes; i++) 
+    {
+      size_t block_size = block_sizes[i];
+      struct bench b;
+      int op;
+
+      bench_start (&b);
+      for (op = 0; op < OP_CNT; op++) 
+        {
+          seek_random (fd, block_size);
+          bench_read (fd, buf, block_size);
+        }
+      bench_report (&b, "rand-read", block_size,
+                    (long long) OP_CNT * block_size);
+
+      bench_start (&b);
+      for (op = 0; op < OP_CNT; op++) 
+        {
+          seek_random (fd, block_size);
+          bench_write (fd, buf, block_size);
+        }
+      CHECK (fsync (fd) == 0, "fsync \"rand\"");
+      bench_report (&b, "rand-write", block_size,
+                    (long long) OP_CNT * block_size);
+    }
+
+  close (fd);
+  CHECK (remove ("rand"), "remove \"rand\"");
+}
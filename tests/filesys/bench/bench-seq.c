@@ -0,0 +1,45 @@
+/* Writes and then reads a file sequentially at several block
+   sizes, timing each pass. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_SIZE (512 * 1024)
+
+static char buf[64 * 1024];
+static const size_t block_sizes[] = {512, 4096, 64 * 1024};
+
+void
+test_main (void) 
+{
+  size_t i;
+
+  for (i = 0; i < sizeof block_sizes / sizeof *block_sizes; i++) 
+    {
+      size_t block_size = block_sizes[i];
+      struct bench b;
+      size_t ofs;
+      int fd;
+
+      CHECK (create ("seq", 0), "create \"seq\"");
+      CHECK ((fd = open ("seq")) > 1, "open \"seq\"");
+
+      bench_start (&b);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+        bench_write (fd, buf, block_size);
+      CHECK (fsync (fd) == 0, "fsync \"seq\"");
+      bench_report (&b, "seq-write", block_size, FILE_SIZE);
+
+      seek (fd, 0);
+      bench_start (&b);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += block_size)
+        bench_read (fd, buf, block_size);
+      bench_report (&b, "seq-read", block_size, FILE_SIZE);
+
+      close (fd);
+      CHECK (remove ("seq"), "remove \"seq\"");
+    }
+}
@@ -0,0 +1,37 @@
+/* Runs several reader processes over one shared file alongside
+   several writer processes that each write their own file, and
+   times them all together. */
+
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+#include "tests/filesys/bench/bench-syn.h"
+
+static char buf[BLOCK_SIZE];
+
+void
+test_main (void) 
+{
+  pid_t readers[READER_CNT], writers[WRITER_CNT];
+  struct bench b;
+  size_t ofs;
+  int fd;
+
+  CHECK (create (shared_name, 0), "create \"%s\"", shared_name);
+  CHECK ((fd = open (shared_name)) > 1, "open \"%s\"", shared_name);
+  for (ofs = 0; ofs < FILE_SIZE; ofs += sizeof buf)
+    bench_write (fd, buf, sizeof buf);
+  msg ("close \"%s\"", shared_name);
+  close (fd);
+  sync ();
+
+  bench_start (&b);
+  exec_children ("bench-child-read", readers, READER_CNT);
+  exec_children ("bench-child-write", writers, WRITER_CNT);
+  wait_children (readers, READER_CNT);
+  wait_children (writers, WRITER_CNT);
+  sync ();
+  bench_report (&b, "concurrent", BLOCK_SIZE,
+                (long long) (READER_CNT + WRITER_CNT) * FILE_SIZE);
+}
@@ -0,0 +1,16 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_SYN_H
+#define TESTS_FILESYS_BENCH_BENCH_SYN_H
+
+/* Shared file that the readers read. */
+static const char shared_name[] = "shared";
+
+/* Size of the shared file and of each writer's own file. */
+#define FILE_SIZE (128 * 1024)
+
+/* Block size used by readers and writers. */
+#define BLOCK_SIZE 4096
+
+#define READER_CNT 4
+#define WRITER_CNT 2
+
+#endif /* tests/filesys/bench/bench-syn.h */
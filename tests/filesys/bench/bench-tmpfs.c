@@ -0,0 +1,53 @@
+/* Runs the same scratch-file workload, creating, writing, reading
+   back and removing a series of files, on the disk and in the
+   tmpfs mounted at /tmp. */
+
+#include <stdio.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+#include "tests/filesys/bench/bench.h"
+
+#define FILE_CNT 20
+#define FILE_SIZE (32 * 1024)
+#define BLOCK_SIZE 4096
+
+static char buf[BLOCK_SIZE];
+
+static void
+run (const char *label, const char *prefix) 
+{
+  struct bench b;
+  char name[32];
+  int i;
+
+  bench_start (&b);
+  for (i = 0; i < FILE_CNT; i++) 
+    {
+      size_t ofs;
+      int fd;
+
+      snprintf (name, sizeof name, "%sscratch%d", prefix, i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+      if ((fd = open (name)) < 2)
+        fail ("open \"%s\"", name);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        bench_write (fd, buf, BLOCK_SIZE);
+      seek (fd, 0);
+      for (ofs = 0; ofs < FILE_SIZE; ofs += BLOCK_SIZE)
+        bench_read (fd, buf, BLOCK_SIZE);
+      close (fd);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+  sync ();
+  bench_report (&b, label, BLOCK_SIZE, (long long) FILE_CNT * FILE_SIZE * 2);
+}
+
+void
+test_main (void) 
+{
+  run ("scratch-disk", "");
+  run ("scratch-tmpfs", "/tmp/");
+}
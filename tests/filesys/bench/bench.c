@@ -0,0 +1,53 @@
+/* Measurement helpers shared by the file system benchmarks. */
+
+#include "tests/filesys/bench/bench.h"
+#include <syscall.h>
+#include "tests/lib.h"
+#include "devices/timer.h"
+
+/* Starts measuring into B. */
+void
+bench_start (struct bench *b) 
+{
+  b->start_reads = get_fs_disk_read_cnt ();
+  b->start_writes = get_fs_disk_write_cnt ();
+  b->start_ticks = ticks ();
+}
+
+/* Reports the time and file system disk traffic since
+   bench_start (B) as one line that tests/bench-table can parse:
+   benchmark NAME moved BYTES bytes in blocks of BLOCK_SIZE. */
+void
+bench_report (const struct bench *b, const char *name,
+              size_t block_size, long long bytes) 
+{
+  long long elapsed = ticks () - b->start_ticks;
+  long long reads = get_fs_disk_read_cnt () - b->start_reads;
+  long long writes = get_fs_disk_write_cnt () - b->start_writes;
+  long long rate = elapsed > 0 ? bytes * TIMER_FREQ / elapsed : 0;
+
+  msg ("BENCH %s block=%zu bytes=%lld ticks=%lld bytes/s=%lld "
+       "reads=%lld writes=%lld",
+       name, block_size, bytes, elapsed, rate, reads, writes);
+}
+
+/* Writes SIZE bytes from BUFFER to FD, failing the test on a
+   short write.  Unlike CHECK, prints nothing on success, so as
+   not to time the console. */
+void
+bench_write (int fd, const void *buffer, size_t size) 
+{
+  int cnt = write (fd, buffer, size);
+  if (cnt != (int) size)
+    fail ("write of %zu bytes returned %d", size, cnt);
+}
+
+/* Reads SIZE bytes from FD into BUFFER, failing the test on a
+   short read. */
+void
+bench_read (int fd, void *buffer, size_t size) 
+{
+  int cnt = read (fd, buffer, size);
+  if (cnt != (int) size)
+    fail ("read of %zu bytes returned %d", size, cnt);
+}
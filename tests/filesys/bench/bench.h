@@ -0,0 +1,21 @@
+#ifndef TESTS_FILESYS_BENCH_BENCH_H
+#define TESTS_FILESYS_BENCH_BENCH_H
+
+#include <stddef.h>
+
+/* A measurement in progress. */
+struct bench 
+  {
+    long long start_ticks;      /* Timer ticks at start. */
+    long long start_reads;      /* File system disk sectors read at start. */
+    long long start_writes;     /* File system disk sectors written at start. */
+  };
+
+void bench_start (struct bench *);
+void bench_report (const struct bench *, const char *name,
+                   size_t block_size, long long bytes);
+
+void bench_write (int fd, const void *, size_t size);
+void bench_read (int fd, void *, size_t size);
+
+#endif /* tests/filesys/bench/bench.h */
@@ -0,0 +1,44 @@
+/* Clones a file, overwrites part of the clone, and checks that
+   the original keeps its data, then removes the original and
+   checks that the clone keeps its own. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+
+static char buf[FILE_SIZE];
+static char copy[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("original", 0), "create \"original\"");
+  CHECK ((fd = open ("original")) > 1, "open \"original\"");
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE, "write \"original\"");
+  msg ("close \"original\"");
+  close (fd);
+
+  CHECK (clone ("original", "clone"), "clone \"original\" as \"clone\"");
+  CHECK (!clone ("original", "clone"), "clone onto existing \"clone\" fails");
+  CHECK (!clone ("missing", "other"), "clone of \"missing\" fails");
+
+  /* Overwrite a stretch in the middle of the clone. */
+  memcpy (copy, buf, sizeof buf);
+  random_bytes (copy + 5000, 3000);
+  CHECK ((fd = open ("clone")) > 1, "open \"clone\"");
+  seek (fd, 5000);
+  CHECK (write (fd, copy + 5000, 3000) == 3000, "write \"clone\"");
+  msg ("close \"clone\"");
+  close (fd);
+
+  check_file ("original", buf, sizeof buf);
+  CHECK (remove ("original"), "remove \"original\"");
+  check_file ("clone", copy, sizeof copy);
+}
@@ -0,0 +1,26 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(clone) begin
+(clone) create "original"
+(clone) open "original"
+(clone) write "original"
+(clone) close "original"
+(clone) clone "original" as "clone"
+(clone) clone onto existing "clone" fails
+(clone) clone of "missing" fails
+(clone) open "clone"
+(clone) write "clone"
+(clone) close "clone"
+(clone) open "original" for verification
+(clone) verified contents of "original"
+(clone) close "original"
+(clone) remove "original"
+(clone) open "clone" for verification
+(clone) verified contents of "clone"
+(clone) close "clone"
+(clone) end
+EOF
+pass;
@@ -0,0 +1,47 @@
+/* Writes compressible text, random bytes and a hole to a file
+   stored compressed, rewrites part of it, and checks that it all
+   reads back. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE (100 * 1024)
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "compress";
+  static const char line[] = "All work and no play makes Jack a dull boy.\n";
+  size_t ofs;
+  int fd;
+
+  /* Text, then a run of zeros, then random bytes. */
+  for (ofs = 0; ofs < 48 * 1024; ofs++)
+    buf[ofs] = line[ofs % (sizeof line - 1)];
+  random_bytes (buf + 80 * 1024, FILE_SIZE - 80 * 1024);
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (set_compressed (fd), "set_compressed \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE, "write \"%s\"", file_name);
+
+  /* Overwrite a stretch that straddles two chunks. */
+  random_bytes (buf + 15000, 3000);
+  seek (fd, 15000);
+  CHECK (write (fd, buf + 15000, 3000) == 3000, "rewrite \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\" again", file_name);
+  CHECK (!set_compressed (fd), "set_compressed \"%s\" fails once written",
+         file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,21 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(compress) begin
+(compress) create "compress"
+(compress) open "compress"
+(compress) set_compressed "compress"
+(compress) write "compress"
+(compress) rewrite "compress"
+(compress) close "compress"
+(compress) open "compress" again
+(compress) set_compressed "compress" fails once written
+(compress) close "compress"
+(compress) open "compress" for verification
+(compress) verified contents of "compress"
+(compress) close "compress"
+(compress) end
+EOF
+pass;
@@ -0,0 +1,59 @@
+/* Grows two files a sector at a time in turn, forcing each sector
+   to disk as it is written so that their sectors interleave, then
+   removes one and defragments.  Checks that the other file ends up
+   in fewer extents, that free space coalesces, and that its data
+   survives the move. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 20
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+static char other[SECTOR_SIZE];
+
+void
+test_main (void) 
+{
+  struct frag_stats before, after;
+  int fd, other_fd;
+  int i;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("keep", 0), "create \"keep\"");
+  CHECK (create ("drop", 0), "create \"drop\"");
+  CHECK ((fd = open ("keep")) > 1, "open \"keep\"");
+  CHECK ((other_fd = open ("drop")) > 1, "open \"drop\"");
+  msg ("write both files a sector at a time");
+  for (i = 0; i < SECTOR_CNT; i++)
+    {
+      if (write (fd, buf + i * SECTOR_SIZE, SECTOR_SIZE) != SECTOR_SIZE
+          || fsync (fd) != 0)
+        fail ("write \"keep\" sector %d", i);
+      if (write (other_fd, other, SECTOR_SIZE) != SECTOR_SIZE
+          || fsync (other_fd) != 0)
+        fail ("write \"drop\" sector %d", i);
+    }
+  msg ("close \"drop\"");
+  close (other_fd);
+  CHECK (remove ("drop"), "remove \"drop\"");
+
+  CHECK (defrag (&before, &after) > 0, "defrag");
+  if (after.extent_cnt >= before.extent_cnt)
+    fail ("%d extents after defrag, %d before", after.extent_cnt,
+          before.extent_cnt);
+  if (after.free_run_cnt >= before.free_run_cnt)
+    fail ("%d free runs after defrag, %d before", after.free_run_cnt,
+          before.free_run_cnt);
+  if (after.free_cnt != before.free_cnt)
+    fail ("%d sectors free after defrag, %d before", after.free_cnt,
+          before.free_cnt);
+  msg ("fewer extents and free runs after defrag");
+
+  msg ("close \"keep\"");
+  close (fd);
+  check_file ("keep", buf, sizeof buf);
+}
@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(defrag) begin
+(defrag) create "keep"
+(defrag) create "drop"
+(defrag) open "keep"
+(defrag) open "drop"
+(defrag) write both files a sector at a time
+(defrag) close "drop"
+(defrag) remove "drop"
+(defrag) defrag
+(defrag) fewer extents and free runs after defrag
+(defrag) close "keep"
+(defrag) open "keep" for verification
+(defrag) verified contents of "keep"
+(defrag) close "keep"
+(defrag) end
+EOF
+pass;
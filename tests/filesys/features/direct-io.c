@@ -0,0 +1,46 @@
+/* Writes a file through a descriptor opened with O_DIRECT and
+   checks that the data reads back the same both through another
+   direct descriptor and through the buffer cache. */
+
+#include <random.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 8192
+
+static char buf[FILE_SIZE] __attribute__ ((aligned (512)));
+static char check[FILE_SIZE] __attribute__ ((aligned (512)));
+
+void
+test_main (void) 
+{
+  const char *file_name = "direct";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (open_flags (file_name, 0x100) == -1, "open \"%s\" with bad flags",
+         file_name);
+  CHECK (create (file_name, FILE_SIZE), "create \"%s\"", file_name);
+  CHECK ((fd = open_flags (file_name, O_DIRECT)) > 1,
+         "open \"%s\" with O_DIRECT", file_name);
+
+  /* The first write fills holes through the cache; the second
+     overwrites the now-allocated sectors directly. */
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE, "write \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  random_bytes (buf, sizeof buf);
+  seek (fd, 0);
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE,
+         "write \"%s\" again", file_name);
+
+  seek (fd, 0);
+  CHECK (read (fd, check, sizeof check) == FILE_SIZE,
+         "read \"%s\" directly", file_name);
+  compare_bytes (check, buf, sizeof buf, 0, file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,20 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(direct-io) begin
+(direct-io) open "direct" with bad flags
+(direct-io) create "direct"
+(direct-io) open "direct" with O_DIRECT
+(direct-io) write "direct"
+(direct-io) fsync "direct"
+(direct-io) write "direct" again
+(direct-io) read "direct" directly
+(direct-io) close "direct"
+(direct-io) open "direct" for verification
+(direct-io) verified contents of "direct"
+(direct-io) close "direct"
+(direct-io) end
+EOF
+pass;
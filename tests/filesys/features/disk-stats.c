@@ -0,0 +1,39 @@
+/* Writes a file, forces it to disk, and checks that the file
+   system disk's statistics account for the writes. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  const char *file_name = "stats";
+  struct disk_stats before, after;
+  int fd;
+
+  CHECK (disk_stats (0, 1, DISK_FILESYS, true, &before),
+         "get file system disk write statistics");
+  CHECK (!disk_stats (0, 1, DISK_CLASS_CNT, true, &after),
+         "reject bad request class");
+
+  memset (buf, 'x', sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  CHECK (disk_stats (0, 1, DISK_FILESYS, true, &after),
+         "get file system disk write statistics again");
+  if (after.sector_cnt - before.sector_cnt < (long long) sizeof buf / 512)
+    fail ("only %lld sectors written for %zu bytes",
+          after.sector_cnt - before.sector_cnt, sizeof buf);
+  if (after.request_cnt <= before.request_cnt)
+    fail ("no write requests counted");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(disk-stats) begin
+(disk-stats) get file system disk write statistics
+(disk-stats) reject bad request class
+(disk-stats) create "stats"
+(disk-stats) open "stats"
+(disk-stats) write "stats"
+(disk-stats) fsync "stats"
+(disk-stats) close "stats"
+(disk-stats) get file system disk write statistics again
+(disk-stats) end
+EOF
+pass;
@@ -0,0 +1,26 @@
+/* Reads the kernel log and checks that it records loading this
+   program, in whole lines, and that a buffer too small for any
+   line gets nothing. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096];
+
+void
+test_main (void) 
+{
+  int n;
+
+  CHECK ((n = dmesg (buf, sizeof buf - 1)) > 0, "dmesg");
+  buf[n] = '\0';
+  if (buf[n - 1] != '\n')
+    fail ("log does not end in a complete line");
+  if (strstr (buf, "dmesg: loaded") == NULL)
+    fail ("log does not record loading \"dmesg\"");
+  msg ("log records loading \"dmesg\"");
+
+  CHECK (dmesg (buf, 8) == 0, "dmesg into 8-byte buffer");
+}
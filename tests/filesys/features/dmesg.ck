@@ -0,0 +1,12 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(dmesg) begin
+(dmesg) dmesg
+(dmesg) log records loading "dmesg"
+(dmesg) dmesg into 8-byte buffer
+(dmesg) end
+EOF
+pass;
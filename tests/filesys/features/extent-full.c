@@ -0,0 +1,40 @@
+/* Grows two files a sector at a time in turn, forcing each sector
+   to disk as it is written so that their sectors interleave and
+   each sector of each file needs an extent of its own.  Writes far
+   more sectors than an inode's extent table holds, and checks that
+   every write succeeds and that both files read back intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define SECTOR_SIZE 512
+#define SECTOR_CNT 128
+
+static char buf[SECTOR_CNT * SECTOR_SIZE];
+
+void
+test_main (void) 
+{
+  int fd[2];
+  int i, j;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create ("a", 0), "create \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK ((fd[0] = open ("a")) > 1, "open \"a\"");
+  CHECK ((fd[1] = open ("b")) > 1, "open \"b\"");
+  msg ("write both files a sector at a time");
+  for (i = 0; i < SECTOR_CNT; i++)
+    for (j = 0; j < 2; j++)
+      if (write (fd[j], buf + i * SECTOR_SIZE, SECTOR_SIZE) != SECTOR_SIZE
+          || fsync (fd[j]) != 0)
+        fail ("write \"%c\" sector %d", 'a' + j, i);
+  msg ("close \"a\"");
+  close (fd[0]);
+  msg ("close \"b\"");
+  close (fd[1]);
+  check_file ("a", buf, sizeof buf);
+  check_file ("b", buf, sizeof buf);
+}
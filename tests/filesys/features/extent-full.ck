@@ -0,0 +1,22 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(extent-full) begin
+(extent-full) create "a"
+(extent-full) create "b"
+(extent-full) open "a"
+(extent-full) open "b"
+(extent-full) write both files a sector at a time
+(extent-full) close "a"
+(extent-full) close "b"
+(extent-full) open "a" for verification
+(extent-full) verified contents of "a"
+(extent-full) close "a"
+(extent-full) open "b" for verification
+(extent-full) verified contents of "b"
+(extent-full) close "b"
+(extent-full) end
+EOF
+pass;
@@ -0,0 +1,48 @@
+/* Reserves space for a file, checks that the reserved range reads
+   as zeros and counts as allocated, then writes into the middle
+   of it and checks that the rest still reads as zeros. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 20000
+#define DATA_OFS 7000
+#define DATA_SIZE 5000
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "prealloc";
+  unsigned start, length;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (fallocate (fd, 0, FILE_SIZE), "fallocate \"%s\"", file_name);
+  if (filesize (fd) != FILE_SIZE)
+    fail ("\"%s\" is %d bytes, expected %d", file_name, filesize (fd),
+          FILE_SIZE);
+
+  CHECK (allocated_range (fd, 0, &start, &length),
+         "allocated_range \"%s\" from 0", file_name);
+  if (start != 0 || length != FILE_SIZE)
+    fail ("allocated range is %u bytes at %u, expected %d bytes at 0",
+          length, start, FILE_SIZE);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+
+  random_bytes (buf + DATA_OFS, DATA_SIZE);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, DATA_OFS);
+  CHECK (write (fd, buf + DATA_OFS, DATA_SIZE) == DATA_SIZE,
+         "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  check_file (file_name, buf, sizeof buf);
+}
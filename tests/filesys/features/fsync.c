@@ -0,0 +1,32 @@
+/* Writes a file, forces it to disk with fsync, fdatasync, and
+   sync, and checks that each call succeeds and that the contents
+   read back intact.  Syncing a bad file descriptor must fail. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[5678];
+
+void
+test_main (void) 
+{
+  const char *file_name = "durable";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == sizeof buf,
+         "write \"%s\"", file_name);
+  CHECK (fdatasync (fd) == 0, "fdatasync \"%s\"", file_name);
+  CHECK (fsync (fd) == 0, "fsync \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+  msg ("sync");
+  sync ();
+  CHECK (fsync (fd) == -1, "fsync closed fd");
+
+  check_file (file_name, buf, sizeof buf);
+}
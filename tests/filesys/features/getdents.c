@@ -0,0 +1,67 @@
+/* Creates enough files to grow the root directory, removes some,
+   and checks that getdents() returns each remaining file exactly
+   once, a few entries per call. */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_CNT 40
+#define BATCH_CNT 7
+
+static int seen[FILE_CNT];
+
+void
+test_main (void) 
+{
+  struct dirent ents[BATCH_CNT];
+  unsigned pos = 0;
+  char name[16];
+  int i, n, call_cnt = 0;
+
+  msg ("create %d files", FILE_CNT);
+  for (i = 0; i < FILE_CNT; i++)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!create (name, 0))
+        fail ("create \"%s\"", name);
+    }
+  msg ("remove every third file");
+  for (i = 0; i < FILE_CNT; i += 3)
+    {
+      snprintf (name, sizeof name, "file%d", i);
+      if (!remove (name))
+        fail ("remove \"%s\"", name);
+    }
+
+  while ((n = getdents ("/", &pos, ents, BATCH_CNT)) > 0)
+    {
+      call_cnt++;
+      if (n > BATCH_CNT)
+        fail ("getdents returned %d entries", n);
+      for (i = 0; i < n; i++)
+        {
+          int idx;
+          if (memcmp (ents[i].name, "file", 4) || ents[i].type != DT_REG)
+            continue;
+          idx = atoi (ents[i].name + 4);
+          if (idx < 0 || idx >= FILE_CNT)
+            fail ("unexpected entry \"%s\"", ents[i].name);
+          seen[idx]++;
+        }
+    }
+  CHECK (n == 0, "getdents reaches the end of \"/\"");
+  if (call_cnt * BATCH_CNT < FILE_CNT - (FILE_CNT + 2) / 3)
+    fail ("only %d calls to getdents", call_cnt);
+
+  for (i = 0; i < FILE_CNT; i++)
+    if (seen[i] != (i % 3 != 0))
+      fail ("\"file%d\" listed %d times", i, seen[i]);
+  msg ("each remaining file listed once");
+
+  CHECK (getdents ("/nonexistent", &pos, ents, BATCH_CNT) == -1,
+         "getdents on a non-directory fails");
+}
@@ -0,0 +1,14 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(getdents) begin
+(getdents) create 40 files
+(getdents) remove every third file
+(getdents) getdents reaches the end of "/"
+(getdents) each remaining file listed once
+(getdents) getdents on a non-directory fails
+(getdents) end
+EOF
+pass;
@@ -0,0 +1,42 @@
+/* Writes a file small enough to be stored inside its inode, then
+   grows it a few bytes at a time well past that size and checks
+   that the data written before and after it moved out of the
+   inode reads back intact. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[2000];
+
+void
+test_main (void) 
+{
+  const char *file_name = "inline";
+  unsigned start, length;
+  size_t ofs;
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 20), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, 20) == 20, "write \"%s\"", file_name);
+  CHECK (allocated_range (fd, 0, &start, &length),
+         "allocated_range \"%s\"", file_name);
+  if (start != 0 || length != 20)
+    fail ("allocated range is %u bytes at %u, expected 20 bytes at 0",
+          length, start);
+
+  msg ("grow \"%s\"", file_name);
+  for (ofs = 20; ofs < sizeof buf; ofs += 37)
+    {
+      size_t size = sizeof buf - ofs < 37 ? sizeof buf - ofs : 37;
+      if (write (fd, buf + ofs, size) != (int) size)
+        fail ("write %zu bytes at offset %zu failed", size, ofs);
+    }
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,18 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(inline-grow) begin
+(inline-grow) create "inline"
+(inline-grow) open "inline"
+(inline-grow) write "inline"
+(inline-grow) allocated_range "inline"
+(inline-grow) grow "inline"
+(inline-grow) close "inline"
+(inline-grow) open "inline" for verification
+(inline-grow) verified contents of "inline"
+(inline-grow) close "inline"
+(inline-grow) end
+EOF
+pass;
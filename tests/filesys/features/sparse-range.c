@@ -0,0 +1,37 @@
+/* Writes a few bytes far past the end of an empty file and checks
+   that only the sector written to is reported as allocated, while
+   the hole in front of it reads back as zeros. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[30006];
+
+void
+test_main (void) 
+{
+  const char *file_name = "sparse";
+  unsigned start, length;
+  int fd;
+
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  msg ("seek \"%s\"", file_name);
+  seek (fd, 30000);
+  CHECK (write (fd, "sparse", 6) == 6, "write \"%s\"", file_name);
+
+  CHECK (allocated_range (fd, 0, &start, &length),
+         "allocated_range \"%s\" from 0", file_name);
+  if (start != 29696 || length != 310)
+    fail ("allocated range is %u bytes at %u, expected 310 bytes at 29696",
+          length, start);
+  CHECK (!allocated_range (fd, sizeof buf, &start, &length),
+         "no allocated range past end of \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  memcpy (buf + 30000, "sparse", 6);
+  check_file (file_name, buf, sizeof buf);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(sparse-range) begin
+(sparse-range) create "sparse"
+(sparse-range) open "sparse"
+(sparse-range) seek "sparse"
+(sparse-range) write "sparse"
+(sparse-range) allocated_range "sparse" from 0
+(sparse-range) no allocated range past end of "sparse"
+(sparse-range) close "sparse"
+(sparse-range) open "sparse" for verification
+(sparse-range) verified contents of "sparse"
+(sparse-range) close "sparse"
+(sparse-range) end
+EOF
+pass;
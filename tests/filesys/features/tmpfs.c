@@ -0,0 +1,30 @@
+/* Writes a file in the tmpfs mounted at /tmp, checks that it reads
+   back and is not on disk, then removes it. */
+
+#include <random.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+#define FILE_SIZE 10000
+
+static char buf[FILE_SIZE];
+
+void
+test_main (void) 
+{
+  const char *file_name = "/tmp/scratch";
+  int fd;
+
+  random_bytes (buf, sizeof buf);
+  CHECK (create (file_name, 0), "create \"%s\"", file_name);
+  CHECK ((fd = open (file_name)) > 1, "open \"%s\"", file_name);
+  CHECK (write (fd, buf, sizeof buf) == FILE_SIZE, "write \"%s\"", file_name);
+  msg ("close \"%s\"", file_name);
+  close (fd);
+
+  check_file (file_name, buf, sizeof buf);
+  CHECK (open ("scratch") == -1, "open \"scratch\" on disk fails");
+  CHECK (remove (file_name), "remove \"%s\"", file_name);
+  CHECK (open (file_name) == -1, "open removed \"%s\" fails", file_name);
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected (IGNORE_EXIT_CODES => 1, [<<'EOF']);
+(tmpfs) begin
+(tmpfs) create "/tmp/scratch"
+(tmpfs) open "/tmp/scratch"
+(tmpfs) write "/tmp/scratch"
+(tmpfs) close "/tmp/scratch"
+(tmpfs) open "/tmp/scratch" for verification
+(tmpfs) verified contents of "/tmp/scratch"
+(tmpfs) close "/tmp/scratch"
+(tmpfs) open "scratch" on disk fails
+(tmpfs) remove "/tmp/scratch"
+(tmpfs) open removed "/tmp/scratch" fails
+(tmpfs) end
+EOF
+pass;
@@ -0,0 +1,83 @@
+/* Times bitmap_scan() on a bitmap the size of a swap table that is
+   mostly full, against a scan that tests one bit at a time, and
+   checks that the two agree.  This is a benchmark rather than a
+   pass/fail test, so it is not part of the graded test set; run it
+   with "run bitmap-scan". */
+
+#include <stdio.h>
+#include <bitmap.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/malloc.h"
+#include "devices/timer.h"
+
+/* Bits in the bitmap: one per page of a 128 MB swap disk. */
+#define BIT_CNT 32768
+
+/* Number of scans timed for each group size. */
+#define SCAN_CNT 200
+
+/* Finds CNT consecutive false bits in B the slow way. */
+static size_t
+slow_scan (const struct bitmap *b, size_t start, size_t cnt)
+{
+  size_t i, j;
+
+  for (i = start; i + cnt <= bitmap_size (b); i++)
+    {
+      for (j = 0; j < cnt; j++)
+        if (bitmap_test (b, i + j))
+          break;
+      if (j == cnt)
+        return i;
+    }
+  return BITMAP_ERROR;
+}
+
+void
+test_bitmap_scan (void) 
+{
+  static const size_t cnts[] = {1, 8, 64};
+  struct bitmap *b;
+  size_t i, k;
+
+  b = bitmap_create (BIT_CNT);
+  if (b == NULL)
+    fail ("bitmap_create failed");
+
+  /* Fill all but a few scattered bits, leaving the free space at
+     the far end, as on a swap disk that has been in use a while. */
+  random_init (0);
+  bitmap_set_all (b, true);
+  for (i = 0; i < BIT_CNT / 64; i++)
+    bitmap_reset (b, random_ulong () % BIT_CNT);
+  bitmap_set_multiple (b, BIT_CNT - 256, 256, false);
+
+  msg ("%d bits, %zu free.", BIT_CNT, bitmap_count (b, 0, BIT_CNT, false));
+  for (k = 0; k < sizeof cnts / sizeof *cnts; k++)
+    {
+      size_t cnt = cnts[k];
+      size_t fast = 0, slow = 0;
+      int64_t start, fast_ticks, slow_ticks;
+
+      start = timer_ticks ();
+      for (i = 0; i < SCAN_CNT; i++)
+        slow = slow_scan (b, 0, cnt);
+      slow_ticks = timer_elapsed (start);
+
+      start = timer_ticks ();
+      for (i = 0; i < SCAN_CNT; i++)
+        fast = bitmap_scan (b, 0, cnt, false);
+      fast_ticks = timer_elapsed (start);
+
+      if (fast != slow)
+        fail ("%zu bits: bitmap_scan found %zu, expected %zu",
+              cnt, fast, slow);
+      msg ("%zu bits at %zu: bit by bit %"PRId64" ticks, "
+           "bitmap_scan %"PRId64" ticks.",
+           cnt, fast, slow_ticks, fast_ticks);
+    }
+
+  bitmap_destroy (b);
+  pass ();
+}
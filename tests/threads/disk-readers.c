@@ -0,0 +1,68 @@
+/* Starts several threads that each read sectors scattered over
+   the file system disk at once, and reports how long they took
+   all together.  This is a benchmark for the disk scheduler
+   rather than a pass/fail test, so it is not part of the graded
+   test set; run it with "run disk-readers" on a kernel built
+   with a file system disk. */
+
+#include <stdio.h>
+#include <random.h>
+#include "tests/threads/tests.h"
+#include "threads/synch.h"
+#include "threads/thread.h"
+#include "devices/disk.h"
+#include "devices/timer.h"
+
+/* Number of concurrent readers. */
+#define READER_CNT 16
+
+/* Number of sectors each reader reads. */
+#define READ_CNT 64
+
+/* Each reader reads this many consecutive sectors at a time, one
+   request per sector, so that merging has something to do. */
+#define RUN_LEN 4
+
+static thread_func disk_reader;
+static struct disk *disk;
+static struct semaphore done;
+
+void
+test_disk_readers (void) 
+{
+  int64_t start;
+  int i;
+
+  disk = disk_get (0, 1);
+  if (disk == NULL)
+    fail ("no file system disk");
+
+  msg ("%d threads reading %d sectors each.", READER_CNT, READ_CNT);
+  sema_init (&done, 0);
+  start = timer_ticks ();
+  for (i = 0; i < READER_CNT; i++) 
+    {
+      char name[16];
+      snprintf (name, sizeof name, "reader %d", i);
+      thread_create (name, PRI_DEFAULT, disk_reader, NULL);
+    }
+  for (i = 0; i < READER_CNT; i++)
+    sema_down (&done);
+  msg ("Took %"PRId64" ticks.", timer_elapsed (start));
+  disk_print_stats ();
+}
+
+static void
+disk_reader (void *aux UNUSED) 
+{
+  static char buffer[DISK_SECTOR_SIZE];
+  int i, j;
+
+  for (i = 0; i < READ_CNT; i += RUN_LEN) 
+    {
+      disk_sector_t sector = random_ulong () % (disk_size (disk) - RUN_LEN);
+      for (j = 0; j < RUN_LEN; j++)
+        disk_read (disk, sector + j, buffer);
+    }
+  sema_up (&done);
+}
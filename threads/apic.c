@@ -0,0 +1,243 @@
+#include "threads/apic.h"
+#include <debug.h>
+#include <stdio.h>
+#include "threads/init.h"
+#include "threads/interrupt.h"
+#include "threads/io.h"
+#include "threads/mmu.h"
+#include "threads/pte.h"
+#include "threads/vaddr.h"
+#include "intrinsic.h"
+
+/* With the -apic option, on a CPU that has a local APIC, external
+   interrupts are delivered through it and the I/O APIC instead of
+   the 8259 PICs.  The I/O APIC sends ISA IRQ N to vector 0x20 + N,
+   just as the PICs did, so drivers register their handlers the
+   same way either way.  Ending an interrupt is then a single write
+   to a local APIC register rather than port I/O to one or both
+   PICs, and the local APIC timer replaces the 8254 PIT as the tick
+   source.  Otherwise the PICs stay in charge.  They remain the
+   default until this path has been tested under QEMU.  See
+   [IA32-v3a] chapter 10 "Advanced Programmable Interrupt
+   Controller (APIC)" and [82093AA] for details. */
+
+/* CPUID leaf 1 EDX bit: the CPU has a local APIC. */
+#define CPUID_APIC (1 << 9)
+
+/* Model-specific register with the local APIC's base address. */
+#define MSR_APIC_BASE 0x1b
+#define APIC_BASE_ENABLE (1 << 11)     /* Global enable. */
+#define APIC_BASE_ADDR 0xfffff000      /* Physical base address. */
+
+/* Physical address of the I/O APIC.  Chipsets put it here unless
+   the ACPI tables say otherwise, and we do not read those. */
+#define IOAPIC_PHYS 0xfec00000
+
+/* Local APIC registers, as byte offsets from its base. */
+#define LAPIC_TPR 0x080                 /* Task priority. */
+#define LAPIC_EOI 0x0b0                 /* End of interrupt. */
+#define LAPIC_SVR 0x0f0                 /* Spurious interrupt vector. */
+#define LAPIC_LVT_TIMER 0x320           /* Timer interrupt. */
+#define LAPIC_LVT_LINT0 0x350           /* LINT0 pin interrupt. */
+#define LAPIC_TIMER_INIT 0x380          /* Timer initial count. */
+#define LAPIC_TIMER_CUR 0x390           /* Timer current count. */
+#define LAPIC_TIMER_DIV 0x3e0           /* Timer divide configuration. */
+
+#define SVR_ENABLE 0x100                /* Software enable. */
+#define LVT_LEVEL (1 << 15)             /* Level triggered. */
+#define LVT_MASKED (1 << 16)            /* Interrupt masked. */
+#define LVT_PERIODIC (1 << 17)          /* Timer reloads at 0. */
+#define TIMER_DIV_16 0x3                /* Timer counts bus clock / 16. */
+
+/* I/O APIC registers, reached by writing their index to IOREGSEL
+   and then accessing IOWIN. */
+#define IOAPIC_REGSEL 0x00
+#define IOAPIC_WIN 0x10
+#define IOAPIC_VER 0x01                         /* Version, pin count. */
+#define IOAPIC_REDTBL(PIN) (0x10 + 2 * (PIN))   /* Pin's routing. */
+
+/* ISA IRQs routed through the I/O APIC.  Pin 0 carries the PICs'
+   output and pin 2 the PIT, neither of which we use. */
+#define ISA_IRQ_CNT 16
+
+/* Vector of spurious local APIC interrupts, which need no end of
+   interrupt. */
+#define SPURIOUS_VEC 0xff
+
+bool apic_requested;
+
+/* Are interrupts delivered through the APICs? */
+static bool enabled;
+
+/* Registers, mapped uncached into the kernel address space. */
+static volatile uint8_t *lapic;
+static volatile uint8_t *ioapic;
+
+static intr_handler_func spurious_interrupt;
+
+static uint32_t
+lapic_read (int reg) {
+	return *(volatile uint32_t *) (lapic + reg);
+}
+
+static void
+lapic_write (int reg, uint32_t value) {
+	*(volatile uint32_t *) (lapic + reg) = value;
+}
+
+static uint32_t
+ioapic_read (int reg) {
+	*(volatile uint32_t *) (ioapic + IOAPIC_REGSEL) = reg;
+	return *(volatile uint32_t *) (ioapic + IOAPIC_WIN);
+}
+
+static void
+ioapic_write (int reg, uint32_t value) {
+	*(volatile uint32_t *) (ioapic + IOAPIC_REGSEL) = reg;
+	*(volatile uint32_t *) (ioapic + IOAPIC_WIN) = value;
+}
+
+/* Returns true if the CPU has a local APIC. */
+static bool
+has_apic (void) {
+	uint32_t eax = 1, ebx, ecx = 0, edx;
+
+	asm volatile ("cpuid" : "+a" (eax), "=b" (ebx), "+c" (ecx), "=d" (edx));
+	return (edx & CPUID_APIC) != 0;
+}
+
+/* Maps the page of device registers at physical address PA into
+   the kernel's address space, with caching disabled, and returns
+   its kernel virtual address.  Device registers lie above the
+   RAM that paging_init() maps. */
+static volatile uint8_t *
+map_registers (uint64_t pa) {
+	uint64_t *pte = pml4e_walk (base_pml4, (uint64_t) ptov (pa), 1);
+
+	if (pte == NULL)
+		PANIC ("can't map APIC registers");
+	*pte = pa | PTE_P | PTE_W | PTE_PWT | PTE_PCD;
+	return ptov (pa);
+}
+
+/* Switches interrupt delivery from the 8259 PICs, which must
+   already be remapped to vectors 0x20...0x2f, to the local APIC
+   and I/O APIC, if -apic was given and the CPU has them. */
+void
+apic_init (void) {
+	uint64_t base;
+	int pin, pin_cnt;
+
+	if (!apic_requested || !has_apic ())
+		return;
+
+	base = read_msr (MSR_APIC_BASE);
+	write_msr (MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+	lapic = map_registers (base & APIC_BASE_ADDR);
+	ioapic = map_registers (IOAPIC_PHYS);
+
+	/* Mask every PIC line, so that only the APICs interrupt. */
+	outb (0x21, 0xff);
+	outb (0xa1, 0xff);
+
+	/* Enable the local APIC, accepting every priority, with
+	   LINT0, where the PICs used to deliver, masked. */
+	intr_register_int (SPURIOUS_VEC, 0, INTR_OFF, spurious_interrupt,
+			"APIC Spurious");
+	lapic_write (LAPIC_SVR, SVR_ENABLE | SPURIOUS_VEC);
+	lapic_write (LAPIC_TPR, 0);
+	lapic_write (LAPIC_LVT_LINT0, LVT_MASKED);
+	lapic_write (LAPIC_LVT_TIMER, LVT_MASKED);
+
+	/* Route ISA IRQ N, edge triggered and active high, to vector
+	   0x20 + N on this CPU, and mask the rest of the pins. */
+	pin_cnt = ((ioapic_read (IOAPIC_VER) >> 16) & 0xff) + 1;
+	for (pin = 0; pin < pin_cnt; pin++) {
+		uint32_t low = LVT_MASKED;
+		if (pin < ISA_IRQ_CNT && pin != 0 && pin != 2)
+			low = 0x20 + pin;
+		ioapic_write (IOAPIC_REDTBL (pin) + 1, 0);
+		ioapic_write (IOAPIC_REDTBL (pin), low);
+	}
+
+	enabled = true;
+	printf ("Interrupts delivered through local APIC and I/O APIC.\n");
+}
+
+/* Returns true if interrupts are delivered through the APICs. */
+bool
+apic_enabled (void) {
+	return enabled;
+}
+
+/* Signals the end of an external interrupt to the local APIC. */
+void
+apic_end_of_interrupt (void) {
+	ASSERT (enabled);
+	lapic_write (LAPIC_EOI, 0);
+}
+
+/* Makes the I/O APIC treat ISA IRQ IRQ as level triggered, as PCI
+   devices sharing an interrupt line require.  Does nothing if the
+   APICs are not in use; the BIOS sets up the PICs' equivalent. */
+void
+apic_set_level_triggered (int irq) {
+	ASSERT (irq > 0 && irq < ISA_IRQ_CNT && irq != 2);
+
+	if (enabled)
+		ioapic_write (IOAPIC_REDTBL (irq), LVT_LEVEL | (0x20 + irq));
+}
+
+/* Returns how many times per second the local APIC timer counts,
+   measured against channel 2 of the 8254 PIT, whose input clock
+   runs at a known 1193180 Hz, over 10 ms.  See [8254]. */
+static uint64_t
+timer_rate (void) {
+	uint16_t count = 1193180 / 100;
+	uint32_t elapsed;
+
+	/* Gate channel 2 on, with the speaker off. */
+	outb (0x61, (inb (0x61) & ~0x02) | 0x01);
+
+	/* CW: counter 2, LSB then MSB, mode 0, binary.  Mode 0 raises
+	   the counter's output, read back in bit 5 of port 0x61, when
+	   the count runs out. */
+	outb (0x43, 0xb0);
+	outb (0x42, count & 0xff);
+	outb (0x42, count >> 8);
+
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_TIMER_INIT, UINT32_MAX);
+	while ((inb (0x61) & 0x20) == 0)
+		continue;
+	elapsed = UINT32_MAX - lapic_read (LAPIC_TIMER_CUR);
+	lapic_write (LAPIC_TIMER_INIT, 0);
+
+	return (uint64_t) elapsed * 100;
+}
+
+/* Starts the local APIC timer interrupting on VEC_NO FREQ times
+   per second, in place of the 8254 PIT.
+   Returns false, doing nothing, if the APICs are not in use. */
+bool
+apic_timer_start (uint8_t vec_no, int freq) {
+	uint64_t rate;
+
+	ASSERT (freq > 0);
+
+	if (!enabled)
+		return false;
+
+	rate = timer_rate ();
+	lapic_write (LAPIC_TIMER_DIV, TIMER_DIV_16);
+	lapic_write (LAPIC_LVT_TIMER, LVT_PERIODIC | vec_no);
+	lapic_write (LAPIC_TIMER_INIT, (rate + freq / 2) / freq);
+	return true;
+}
+
+/* Spurious interrupt handler.  The local APIC raises these when an
+   interrupt goes away before it can be delivered.  They need no
+   end of interrupt, so there is nothing to do. */
+static void
+spurious_interrupt (struct intr_frame *f UNUSED) {
+}
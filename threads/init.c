@@ -1,6 +1,7 @@
 #include "threads/init.h"
 #include <console.h>
 #include <debug.h>
+#include <klog.h>
 #include <limits.h>
 #include <random.h>
 #include <stddef.h>
@@ -9,16 +10,19 @@
 #include <stdlib.h>
 #include <string.h>
 #include "devices/kbd.h"
+#include "devices/ramdisk.h"
 #include "devices/input.h"
 #include "devices/serial.h"
 #include "devices/timer.h"
 #include "devices/vga.h"
+#include "threads/apic.h"
 #include "threads/interrupt.h"
 #include "threads/io.h"
 #include "threads/loader.h"
 #include "threads/malloc.h"
 #include "threads/mmu.h"
 #include "threads/palloc.h"
+#include "threads/profile.h"
 #include "threads/pte.h"
 #include "threads/thread.h"
 #ifdef USERPROG
@@ -36,6 +40,7 @@
 #include "devices/disk.h"
 #include "filesys/filesys.h"
 #include "filesys/fsutil.h"
+#include "filesys/inode.h"
 #endif
 
 /* Page-map-level-4 with kernel mappings only. */
@@ -103,6 +108,7 @@ main (void) {
 #endif
 	/* Start thread scheduler and enable interrupts. */
 	thread_start ();
+	klog_init ();
 	serial_init_queue ();
 	timer_calibrate ();
 
@@ -216,11 +222,23 @@ parse_options (char **argv) {
 #ifdef FILESYS
 		else if (!strcmp (name, "-f"))
 			format_filesys = true;
+		else if (!strcmp (name, "-ramdisk"))
+			ramdisk_configure (value);
 #endif
 		else if (!strcmp (name, "-rs"))
 			random_init (atoi (value));
 		else if (!strcmp (name, "-mlfqs"))
 			thread_mlfqs = true;
+		else if (!strcmp (name, "-profile"))
+			profile_enabled = true;
+		else if (!strcmp (name, "-loglevel")) {
+			int level = value != NULL ? atoi (value) : -1;
+			if (level < 0 || level >= KLOG_LEVEL_CNT)
+				PANIC ("bad -loglevel (use -h for help)");
+			klog_console_level = level;
+		}
+		else if (!strcmp (name, "-apic"))
+			apic_requested = true;
 #ifdef USERPROG
 		else if (!strcmp (name, "-ul"))
 			user_page_limit = atoi (value);
@@ -324,8 +342,16 @@ usage (void) {
 			"  -h                 Print this help message and power off.\n"
 			"  -q                 Power off VM after actions or on panic.\n"
 			"  -f                 Format file system disk during startup.\n"
+			"  -ramdisk=C:D:SIZE  Replace disk C:D with a SIZE MB RAM disk.\n"
 			"  -rs=SEED           Set random number seed to SEED.\n"
 			"  -mlfqs             Use multi-level feedback queue scheduler.\n"
+			"  -profile           Sample where the CPU is on each timer tick and\n"
+			"                     print the samples at power off.\n"
+			"  -loglevel=N        Print kernel log messages of level 0 (error),\n"
+			"                     1 (warning, default), 2 (info), or 3 (debug)\n"
+			"                     and above to the console.\n"
+			"  -apic              Deliver interrupts through the local APIC and\n"
+			"                     I/O APIC instead of the 8259 PICs.\n"
 #ifdef USERPROG
 			"  -ul=COUNT          Limit user memory to COUNT pages.\n"
 #endif
@@ -342,6 +368,8 @@ power_off (void) {
 	filesys_done ();
 #endif
 
+	klog_flush ();
+	profile_print ();
 	print_stats ();
 
 	printf ("Powering off...\n");
@@ -356,6 +384,7 @@ print_stats (void) {
 	thread_print_stats ();
 #ifdef FILESYS
 	disk_print_stats ();
+	inode_print_stats ();
 #endif
 	console_print_stats ();
 	kbd_print_stats ();
@@ -3,6 +3,7 @@
 #include <inttypes.h>
 #include <stdint.h>
 #include <stdio.h>
+#include "threads/apic.h"
 #include "threads/flags.h"
 #include "threads/intr-stubs.h"
 #include "threads/io.h"
@@ -138,10 +139,13 @@ intr_enable (void) {
 	ASSERT (!intr_context ());
 
 	/* Enable interrupts by setting the interrupt flag.
+	   The memory clobber keeps the compiler from moving memory
+	   accesses out of the critical section that this ends, just
+	   as the one in intr_disable() keeps them from moving in.
 
 	   See [IA32-v2b] "STI" and [IA32-v3a] 5.8.1 "Masking Maskable
 	   Hardware Interrupts". */
-	asm volatile ("sti");
+	asm volatile ("sti" : : : "memory");
 
 	return old_level;
 }
@@ -201,6 +205,9 @@ intr_init (void) {
 	intr_names[17] = "#AC Alignment Check Exception";
 	intr_names[18] = "#MC Machine-Check Exception";
 	intr_names[19] = "#XF SIMD Floating-Point Exception";
+
+	/* Hand external interrupts to the APICs, if present. */
+	apic_init ();
 }
 
 /* Registers interrupt VEC_NO to invoke HANDLER with descriptor
@@ -367,7 +374,10 @@ intr_handler (struct intr_frame *frame) {
 		ASSERT (intr_context ());
 
 		in_external_intr = false;
-		pic_end_of_interrupt (frame->vec_no);
+		if (apic_enabled ())
+			apic_end_of_interrupt ();
+		else
+			pic_end_of_interrupt (frame->vec_no);
 
 		if (yield_on_return)
 			thread_yield ();
@@ -0,0 +1,130 @@
+#include "threads/profile.h"
+#include <debug.h>
+#include <inttypes.h>
+#include <stdint.h>
+#include <stdio.h>
+#include "threads/vaddr.h"
+
+/* Sampling profiler.
+
+   With -profile, every timer interrupt records where it caught
+   the CPU: for kernel code, the interrupted RIP and the return
+   addresses of up to PROFILE_DEPTH of its callers, found by
+   following the saved frame pointers (the kernel is built with
+   -fno-omit-frame-pointer); for user code, just the RIP.  Equal
+   samples share a slot in a fixed-size histogram.  At power off
+   profile_print() dumps the histogram to the console, where
+   utils/pintos-profile turns it into flat and call graph
+   reports. */
+
+/* Callers recorded with each kernel sample. */
+#define PROFILE_DEPTH 4
+
+/* Slots in the histogram. */
+#define PROFILE_SLOTS 1024
+
+/* A distinct sample and how often it was taken. */
+struct sample {
+	uintptr_t pc[PROFILE_DEPTH + 1]; /* RIP, then callers; 0 pads. */
+	bool user;                       /* Taken in user mode? */
+	unsigned cnt;                    /* Times taken; 0 if unused. */
+};
+
+bool profile_enabled;
+
+/* Only touched by the timer interrupt handler, so no locking. */
+static struct sample samples[PROFILE_SLOTS];
+static long long kernel_cnt;        /* Kernel samples taken. */
+static long long user_cnt;          /* User samples taken. */
+static long long dropped_cnt;       /* Samples not recorded: histogram full. */
+
+/* Returns true if FRAME could be a saved frame pointer on the
+   kernel stack whose top RSP is in. */
+static bool
+is_kernel_frame (void **frame, uintptr_t rsp) {
+	return is_kernel_vaddr (frame)
+		&& (uintptr_t) frame % sizeof (void *) == 0
+		&& (uintptr_t) frame >= rsp
+		&& pg_round_down (frame + 1) == pg_round_down (rsp);
+}
+
+/* Adds the sample in S to the histogram. */
+static void
+record (const struct sample *s) {
+	uint64_t hash = s->user;
+	size_t i, j;
+
+	for (i = 0; i <= PROFILE_DEPTH; i++)
+		hash = hash * 31 + s->pc[i];
+
+	for (i = 0; i < PROFILE_SLOTS; i++) {
+		struct sample *slot = &samples[(hash + i) % PROFILE_SLOTS];
+
+		if (slot->cnt == 0) {
+			*slot = *s;
+			slot->cnt = 1;
+			return;
+		}
+		if (slot->user == s->user) {
+			for (j = 0; j <= PROFILE_DEPTH; j++)
+				if (slot->pc[j] != s->pc[j])
+					break;
+			if (j > PROFILE_DEPTH) {
+				slot->cnt++;
+				return;
+			}
+		}
+	}
+	dropped_cnt++;
+}
+
+/* Records where interrupt frame F, from the timer interrupt,
+   caught the CPU. */
+void
+profile_sample (const struct intr_frame *f) {
+	struct sample s = { .pc = { f->rip }, .user = (f->cs & 3) == 3 };
+
+	ASSERT (intr_context ());
+
+	if (!profile_enabled)
+		return;
+
+	if (s.user)
+		user_cnt++;
+	else {
+		void **frame = (void **) f->R.rbp;
+		int i;
+
+		kernel_cnt++;
+		for (i = 1; i <= PROFILE_DEPTH && is_kernel_frame (frame, f->rsp); i++) {
+			s.pc[i] = (uintptr_t) frame[1];
+			frame = frame[0];
+		}
+	}
+	record (&s);
+}
+
+/* Prints the histogram, one line per distinct sample, for
+   utils/pintos-profile. */
+void
+profile_print (void) {
+	size_t i;
+	int j;
+
+	if (!profile_enabled)
+		return;
+
+	printf ("Profile: begin, %lld kernel and %lld user samples, "
+			"%lld not recorded\n", kernel_cnt, user_cnt, dropped_cnt);
+	for (i = 0; i < PROFILE_SLOTS; i++) {
+		const struct sample *s = &samples[i];
+
+		if (s->cnt == 0)
+			continue;
+		printf ("Profile: %c %u", s->user ? 'u' : 'k', s->cnt);
+		for (j = 0; j <= PROFILE_DEPTH && s->pc[j] != 0; j++)
+			printf (" %#"PRIx64, (uint64_t) s->pc[j]);
+		printf ("\n");
+	}
+	printf ("Profile: end\n");
+}
@@ -1,6 +1,7 @@
 #include "userprog/process.h"
 #include <debug.h>
 #include <inttypes.h>
+#include <klog.h>
 #include <round.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -542,6 +543,7 @@ load (const char *file_name, struct intr_frame *if_) {
 	// hex_dump (if_->rsp, if_->rsp, USER_STACK - if_->rsp, true);
 
 	success = true;
+	klog (KLOG_INFO, "%s: loaded, entry %#"PRIx64, argv[0], ehdr.e_entry);
 
 done:
 	/* We arrive here whether the load is successful or not. */
@@ -1,4 +1,5 @@
 #include "userprog/syscall.h"
+#include <klog.h>
 #include <stdio.h>
 #include <syscall-nr.h>
 #include "threads/interrupt.h"
@@ -15,7 +16,9 @@
 #include "threads/vaddr.h"
 #include "filesys/filesys.h"
 #include "filesys/file.h"
+#include "devices/disk.h"
 #include "devices/input.h"
+#include "devices/timer.h"
 #include "lib/string.h"
 #include "userprog/process.h"
 #include "threads/palloc.h"
@@ -40,12 +43,26 @@ void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
 int dup2 (int oldfd, int newfd);
+bool allocated_range (int fd, unsigned offset, unsigned *start, unsigned *length);
+int fsync (int fd);
+int fdatasync (int fd);
+void sync (void);
+bool disk_stats (int chan_no, int dev_no, enum disk_class class, bool write, struct disk_stats *stats);
+long long ticks (void);
+int open_flags (const char *file, int flags);
+bool set_compressed (int fd);
+bool clone (const char *file, const char *new_file);
+int getdents (const char *dir, unsigned *pos, struct dirent *ents, unsigned cnt);
+bool fallocate (int fd, unsigned offset, unsigned length);
+int defrag (struct frag_stats *before, struct frag_stats *after);
+int dmesg (char *buffer, unsigned size);
 #ifdef VM
 void *mmap (void *addr, size_t length, int writable, int fd, off_t offset);
 void munmap (void *addr);
 #endif
 
 static void check_address (void *addr);
+static int direct_io (struct file *f, void *buffer, unsigned size, bool to_user);
 #ifdef VM
 static void check_buffer (void *buffer, unsigned size);
 static bool check_mmap (void *addr, size_t length, int fd, struct file *file, off_t offset);
@@ -142,6 +159,45 @@ syscall_handler (struct intr_frame *f UNUSED) {
 		case SYS_DUP2:        /* Duplicate the file descriptor. */
 			f->R.rax = dup2 (f->R.rdi, f->R.rsi);
 			break;
+		case SYS_ALLOCATED_RANGE: /* Find allocated data in a sparse file. */
+			f->R.rax = allocated_range (f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_FSYNC:       /* Force a file to disk. */
+			f->R.rax = fsync (f->R.rdi);
+			break;
+		case SYS_FDATASYNC:   /* Force a file's data to disk. */
+			f->R.rax = fdatasync (f->R.rdi);
+			break;
+		case SYS_SYNC:        /* Force all files to disk. */
+			sync ();
+			break;
+		case SYS_DISK_STATS:  /* Read a disk's I/O statistics. */
+			f->R.rax = disk_stats (f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
+			break;
+		case SYS_TICKS:       /* Timer ticks since boot. */
+			f->R.rax = ticks ();
+			break;
+		case SYS_OPEN_FLAGS:  /* Open a file with flags. */
+			f->R.rax = open_flags (f->R.rdi, f->R.rsi);
+			break;
+		case SYS_SET_COMPRESSED: /* Store a file compressed. */
+			f->R.rax = set_compressed (f->R.rdi);
+			break;
+		case SYS_CLONE:       /* Copy a file by sharing its sectors. */
+			f->R.rax = clone (f->R.rdi, f->R.rsi);
+			break;
+		case SYS_GETDENTS:    /* Read many directory entries. */
+			f->R.rax = getdents (f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10);
+			break;
+		case SYS_FALLOCATE:   /* Reserve disk space for a file. */
+			f->R.rax = fallocate (f->R.rdi, f->R.rsi, f->R.rdx);
+			break;
+		case SYS_DEFRAG:      /* Defragment the file system. */
+			f->R.rax = defrag (f->R.rdi, f->R.rsi);
+			break;
+		case SYS_DMESG:       /* Read the kernel log. */
+			f->R.rax = dmesg (f->R.rdi, f->R.rsi);
+			break;
 #ifdef VM
 		case SYS_MMAP:        /* Map a file into memory. */
 			f->R.rax = mmap (f->R.rdi, f->R.rsi, f->R.rdx, f->R.r10, f->R.r8);
@@ -292,7 +348,10 @@ read (int fd, void *buffer, unsigned size) {
 		if (f == NULL)
 			return -1;
 
-		size_read = file_read (f, buffer, size);
+		if (file_is_direct (f) && (uintptr_t) buffer % DISK_SECTOR_SIZE == 0)
+			size_read = direct_io (f, buffer, size, true);
+		else
+			size_read = file_read (f, buffer, size);
 	}
 
 	return size_read;
@@ -317,7 +376,10 @@ write (int fd, const void *buffer, unsigned size) {
 		if (f == NULL)
 			return -1;
 
-		size_written = file_write (f, buffer, size);
+		if (file_is_direct (f) && (uintptr_t) buffer % DISK_SECTOR_SIZE == 0)
+			size_written = direct_io (f, (void *) buffer, size, false);
+		else
+			size_written = file_write (f, buffer, size);
 	}
 
 	return size_written;
@@ -368,6 +430,193 @@ dup2 (int oldfd, int newfd) {
 	exit (-1);
 }
 
+/* Finds the first range of allocated data at or after byte OFFSET of the file open as FD, skipping holes,
+ * and stores its start and length in *START and *LENGTH. Returns false if there is no more data or FD is not a file. */
+bool
+allocated_range (int fd, unsigned offset, unsigned *start, unsigned *length) {
+	struct file *f = fdt_get_file (fd);
+	off_t range_start, range_length;
+
+	check_address (start);
+	check_address (length);
+
+	if (f == NULL || !file_allocated_range (f, offset, &range_start, &range_length))
+		return false;
+
+	*start = range_start;
+	*length = range_length;
+	return true;
+}
+
+/* Opens the file called FILE like open(), with FLAGS. With O_DIRECT, sector-aligned reads and writes of the file move data
+ * between the disk and the caller's memory without passing through the buffer cache. Returns -1 on unknown flags. */
+int
+open_flags (const char *file, int flags) {
+	int fd;
+
+	if (flags & ~O_DIRECT)
+		return -1;
+
+	fd = open (file);
+	if (fd != -1 && (flags & O_DIRECT))
+		file_set_direct (fdt_get_file (fd), true);
+
+	return fd;
+}
+
+/* Makes the file open as FD store its data compressed. Returns false if FD is not a file or the file
+ * is not empty. */
+bool
+set_compressed (int fd) {
+	struct file *f = fdt_get_file (fd);
+
+	return f != NULL && file_set_compressed (f);
+}
+
+/* Creates a file called NEW_FILE with the same contents as FILE, in time that does not depend on FILE's
+ * size: the two share disk sectors until either is written. Returns true if successful, false otherwise. */
+bool
+clone (const char *file, const char *new_file) {
+	check_address (file);
+	check_address (new_file);
+
+	lock_acquire (&filesys_lock);
+	bool result = filesys_clone (file, new_file);
+	lock_release (&filesys_lock);
+
+	return result;
+}
+
+/* Stores up to CNT entries of the directory named DIR, "/" or "/tmp", in ENTS, starting at the position *POS,
+ * which should be 0 at first, and advances *POS past them. Each call reads many entries, about a disk sector's
+ * worth at a time. Returns the number of entries stored, 0 at the end of the directory, or -1 if DIR is not a directory. */
+int
+getdents (const char *dir, unsigned *pos, struct dirent *ents, unsigned cnt) {
+	off_t ofs;
+	int n;
+
+	check_address (dir);
+	check_address (pos);
+	check_address (ents);
+#ifdef VM
+	check_buffer (ents, cnt * sizeof *ents);
+#endif
+
+	if (*pos > INT32_MAX)
+		return -1;
+	ofs = *pos;
+
+	lock_acquire (&filesys_lock);
+	n = filesys_getdents (dir, &ofs, ents, cnt);
+	lock_release (&filesys_lock);
+
+	*pos = ofs;
+	return n;
+}
+
+/* Reserves contiguous disk space for the LENGTH bytes of the file open as FD starting at OFFSET, without writing
+ * it, so that writing the range later does not allocate. The range reads as zeros until written, and the file grows
+ * to cover it. Returns false if FD is not a file, the range is too large, or the disk fills up. */
+bool
+fallocate (int fd, unsigned offset, unsigned length) {
+	struct file *f = fdt_get_file (fd);
+
+	if (f == NULL || offset > INT32_MAX || length > INT32_MAX - offset)
+		return false;
+
+	lock_acquire (&filesys_lock);
+	bool result = file_preallocate (f, offset, length);
+	lock_release (&filesys_lock);
+
+	return result;
+}
+
+/* Moves the data of each file on disk into one contiguous run where it is in pieces, coalescing free space, and
+ * stores the fragmentation before and after in *BEFORE and *AFTER. Returns the number of files moved, or -1 if the
+ * file system cannot be defragmented. */
+int
+defrag (struct frag_stats *before, struct frag_stats *after) {
+	struct frag_stats b, a;
+	int moved;
+
+	check_address (before);
+	check_address (after);
+
+	lock_acquire (&filesys_lock);
+	moved = filesys_defrag (&b, &a);
+	lock_release (&filesys_lock);
+
+	*before = b;
+	*after = a;
+	return moved;
+}
+
+/* Copies the newest kernel log messages that fit in the SIZE bytes of BUFFER, one line each, oldest first, and
+ * returns the number of bytes copied. The buffer is not null-terminated. */
+int
+dmesg (char *buffer, unsigned size) {
+	check_address (buffer);
+#ifdef VM
+	check_buffer (buffer, size);
+#endif
+
+	return klog_read (buffer, size);
+}
+
+/* Forces the data and then the metadata of the file open as FD to disk. Returns 0 once they are on disk,
+ * or -1 if FD is not a file or the disk is too full to hold its data. */
+int
+fsync (int fd) {
+	struct file *f = fdt_get_file (fd);
+
+	if (f == NULL || !file_sync (f))
+		return -1;
+
+	return 0;
+}
+
+/* Like fsync(), but writes the file's metadata only if it is needed to read the data back. */
+int
+fdatasync (int fd) {
+	struct file *f = fdt_get_file (fd);
+
+	if (f == NULL || !file_datasync (f))
+		return -1;
+
+	return 0;
+}
+
+/* Forces every file to disk.  Like fsync() and fdatasync(), this does not take filesys_lock: the inode layer
+ * locks each inode it writes and the list of open inodes, so none of the three blocks on unrelated lookups. */
+void
+sync (void) {
+	filesys_sync ();
+}
+
+/* Copies the I/O statistics of disk DEV_NO on channel CHAN_NO, for requests of CLASS that write if WRITE is true
+ * or read otherwise, into *STATS. Returns false if there is no such disk or class. */
+bool
+disk_stats (int chan_no, int dev_no, enum disk_class class, bool write, struct disk_stats *stats) {
+	struct disk *d;
+
+	check_address (stats);
+
+	if (chan_no < 0 || (dev_no != 0 && dev_no != 1))
+		return false;
+
+	d = disk_get (chan_no, dev_no);
+	if (d == NULL)
+		return false;
+
+	return disk_get_stats (d, class, write, stats);
+}
+
+/* Returns the number of timer ticks since the OS booted, for timing from user programs. */
+long long
+ticks (void) {
+	return timer_ticks ();
+}
+
 #ifdef VM
 void *
 mmap (void *addr, size_t length, int writable, int fd, off_t offset) {
@@ -452,6 +701,53 @@ check_mmap (void *addr, size_t length, int fd, struct file *file, off_t offset)
 }
 #endif
 
+/* Returns the kernel address of user address UADDR and keeps its page in memory until unpin_user (UADDR).
+ * Exits if UADDR is not mapped, or if WRITABLE is true and its page is read-only. */
+static void *
+pin_user (void *uaddr, bool writable) {
+#ifdef VM
+	void *kva = is_user_vaddr (uaddr) ? vm_pin_page (uaddr, writable) : NULL;
+#else
+	struct thread *t = thread_current ();
+	uint64_t *pte = is_user_vaddr (uaddr) ? pml4e_walk (t->pml4, (uint64_t) uaddr, 0) : NULL;
+	void *kva = pte != NULL && (!writable || (*pte & PTE_W)) ? pml4_get_page (t->pml4, uaddr) : NULL;
+#endif
+	if (kva == NULL)
+		exit (-1);
+	return kva;
+}
+
+/* Releases the page pinned by pin_user (UADDR). */
+static void
+unpin_user (void *uaddr UNUSED) {
+#ifdef VM
+	vm_unpin_page (uaddr);
+#endif
+}
+
+/* Reads (if TO_USER) or writes SIZE bytes between direct I/O file F and user BUFFER, a page at a time,
+ * handing the disk the frames that hold BUFFER so that the data moves without a bounce buffer.
+ * Returns the number of bytes transferred. */
+static int
+direct_io (struct file *f, void *buffer, unsigned size, bool to_user) {
+	unsigned done = 0;
+
+	while (done < size) {
+		uint8_t *uaddr = (uint8_t *) buffer + done;
+		unsigned page_left = PGSIZE - pg_ofs (uaddr);
+		unsigned chunk = size - done < page_left ? size - done : page_left;
+		void *kva = pin_user (uaddr, to_user);
+		off_t cnt = to_user ? file_read_direct (f, kva, chunk) : file_write_direct (f, kva, chunk);
+
+		unpin_user (uaddr);
+		done += cnt;
+		if (cnt < (off_t) chunk)
+			break;
+	}
+
+	return done;
+}
+
 /* Add file(FILE) to file descriptor table of running thread */
 static int
 fdt_add_fd (struct file *file) {
@@ -1,6 +1,7 @@
 /* anon.c: Implementation of page for non-disk image (a.k.a. anonymous page). */
 
 #include "vm/vm.h"
+#include <string.h>
 #include "devices/disk.h"
 #include "lib/kernel/bitmap.h"
 
@@ -9,7 +10,10 @@
 /* DO NOT MODIFY BELOW LINE */
 static struct disk *swap_disk;
 static struct bitmap *swap_bitmap;
+static size_t swap_hint;        /* Where to look for a free slot next. */
 
+static void swap_write_done (struct disk_request *);
+static void swap_write_wait (struct anon_page *anon_page);
 static bool anon_swap_in (struct page *page, void *kva);
 static bool anon_swap_out (struct page *page);
 static void anon_destroy (struct page *page);
@@ -40,10 +44,26 @@ anon_initializer (struct page *page, enum vm_type type, void *kva UNUSED) {
 
 	struct anon_page *anon_page = &page->anon;
 	anon_page->type = type;
+	anon_page->writing = false;
 
 	return true;
 }
 
+/* Frees the bounce buffer of a finished swap write.  Runs in the swap disk's channel thread. */
+static void
+swap_write_done (struct disk_request *r) {
+	palloc_free_page (r->buffer);
+}
+
+/* Waits for the swap write of ANON_PAGE, if one is in flight, so that its swap slot can be read or reused. */
+static void
+swap_write_wait (struct anon_page *anon_page) {
+	if (anon_page->writing) {
+		disk_wait (&anon_page->swap_write);
+		anon_page->writing = false;
+	}
+}
+
 /* Swap in the page by read contents from the swap disk. */
 static bool
 anon_swap_in (struct page *page, void *kva) {
@@ -53,9 +73,12 @@ anon_swap_in (struct page *page, void *kva) {
 	if (!bitmap_test (swap_bitmap, anon_page->sec_no / SECTOR_FOR_BIT))
 		return false;
 
-	/* Reading the data contents from the disk to memory. */
-	for (int i = 0; i < SECTOR_FOR_BIT; i++)
-		disk_read (swap_disk, anon_page->sec_no + i, kva + DISK_SECTOR_SIZE * i);
+	/* Reading the data contents from the disk to memory, as a single request. */
+	struct disk_request r;
+	swap_write_wait (anon_page);
+	disk_request_init (&r, swap_disk, false, DISK_SWAP, anon_page->sec_no, kva, SECTOR_FOR_BIT);
+	disk_submit (&r);
+	disk_wait (&r);
 
 	/* Free a swap slot when its contents are read back into a frame(update the swap table). */
 	bitmap_reset (swap_bitmap, anon_page->sec_no / SECTOR_FOR_BIT);
@@ -69,16 +92,34 @@ anon_swap_out (struct page *page) {
 	struct anon_page *anon_page = &page->anon;
 
 	/* Find a free swap slot in the disk using the swap table.
-	 * If there is no more free slot in the disk, panic the kernel. */
-	size_t bit_idx = bitmap_scan_and_flip (swap_bitmap, 0, 1, false);
+	 * If there is no more free slot in the disk, panic the kernel.
+	 * Slots are handed out next-fit, so the scan does not step over
+	 * every slot in use to get to the first free one. */
+	size_t bit_idx = bitmap_scan_hint (swap_bitmap, swap_hint, 1, false);
 	if (bit_idx == BITMAP_ERROR)
 		PANIC ("There is no more free slot in the disk.");
+	bitmap_mark (swap_bitmap, bit_idx);
+	swap_hint = bit_idx + 1;
 
 	disk_sector_t sec_no = bit_idx * SECTOR_FOR_BIT;
 
-	/* Copy the page of data into the slot. */
-	for (int i = 0; i < SECTOR_FOR_BIT; i++)
-		disk_write (swap_disk, sec_no + i, page->frame->kva + DISK_SECTOR_SIZE * i);
+	/* Copy the page of data into the slot.
+	 * The frame is about to be reused, so the data goes out from a bounce buffer and the write proceeds
+	 * on the swap disk's channel while the caller carries on, e.g. loading the new page from the file system disk.
+	 * Without memory for a bounce buffer, write straight from the frame and wait. */
+	void *buffer = palloc_get_page (0);
+	if (buffer != NULL) {
+		memcpy (buffer, page->frame->kva, PGSIZE);
+		disk_request_init (&anon_page->swap_write, swap_disk, true, DISK_SWAP, sec_no, buffer, SECTOR_FOR_BIT);
+		anon_page->swap_write.done = swap_write_done;
+		anon_page->writing = true;
+		disk_submit (&anon_page->swap_write);
+	} else {
+		struct disk_request r;
+		disk_request_init (&r, swap_disk, true, DISK_SWAP, sec_no, page->frame->kva, SECTOR_FOR_BIT);
+		disk_submit (&r);
+		disk_wait (&r);
+	}
 
 	/* The location of the data should be saved in the page struct. */
 	anon_page->sec_no = sec_no;
@@ -107,6 +148,7 @@ anon_destroy (struct page *page) {
 		palloc_free_page (frame->kva);
 		free (frame);
 	} else {
+		swap_write_wait (anon_page);
 		bitmap_reset (swap_bitmap, (anon_page->sec_no) / SECTOR_FOR_BIT);
 	}
 }
\ No newline at end of file
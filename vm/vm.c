@@ -7,7 +7,7 @@
 #include "vm/vm.h"
 #include "vm/anon.h"
 #include "vm/inspect.h"
-#include "lib/kernel/hash.h"
+#include "lib/kernel/rhash.h"
 
 /* Lock(mutex) for modifying spt(hash table). */
 static struct lock pages_lock;
@@ -19,10 +19,10 @@ struct lock frames_lock;
 static struct list frames;
 
 /* hash function and a comparison function using va as the key. */
-static unsigned page_hash (const struct hash_elem *, void *aux);
-static bool page_less (const struct hash_elem *, const struct hash_elem *, void *aux);
+static uint64_t page_hash (const struct rhash_elem *, void *aux);
+static bool page_less (const struct rhash_elem *, const struct rhash_elem *, void *aux);
 static bool install_page (void *upage, void *kpage, bool writable);
-static void page_destructor (struct hash_elem *e, void *aux);
+static void page_destructor (struct rhash_elem *e, void *aux);
 
 /* Initializes the virtual memory subsystem by invoking each subsystem's
  * intialize codes. */
@@ -114,11 +114,11 @@ done:
 struct page *
 spt_find_page (struct supplemental_page_table *spt, void *va) {
   struct page page;
-  struct hash_elem *e;
+  struct rhash_elem *e;
 
   page.va = pg_round_down (va);
-  e = hash_find (&spt->pages, &page.hash_elem);
-  return e != NULL ? hash_entry (e, struct page, hash_elem) : NULL;
+  e = rhash_find (&spt->pages, &page.hash_elem);
+  return e != NULL ? rhash_entry (e, struct page, hash_elem) : NULL;
 }
 
 /* Insert PAGE into spt with validation. */
@@ -127,7 +127,7 @@ spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
 	bool success = false;
 
 	lock_acquire (&pages_lock);
-	struct list_elem *e = hash_insert (&spt->pages, &page->hash_elem);
+	struct rhash_elem *e = rhash_insert (&spt->pages, &page->hash_elem);
 	lock_release (&pages_lock);
 
 	if (e == NULL)
@@ -140,7 +140,7 @@ spt_insert_page (struct supplemental_page_table *spt, struct page *page) {
 void
 spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 	lock_acquire (&pages_lock);
-	struct list_elem *e = hash_delete (&spt->pages, &page->hash_elem);
+	rhash_delete (&spt->pages, &page->hash_elem);
 	lock_release (&pages_lock);
 
 	vm_dealloc_page (page);
@@ -149,14 +149,24 @@ spt_remove_page (struct supplemental_page_table *spt, struct page *page) {
 /* Get the struct frame, that will be evicted. */
 static struct frame *
 vm_get_victim (void) {
-	if (list_empty (&frames))
-		PANIC ("vm_get_victim failed");
+	struct frame *frame = NULL;
 
-	/* FIFO policy for eviction(page replacement). */
+	/* FIFO policy for eviction(page replacement), passing over pinned frames. */
 	lock_acquire (&frames_lock);
-	struct frame *frame = list_entry (list_pop_back (&frames), struct frame, f_elem);
+	for (struct list_elem *e = list_rbegin (&frames); e != list_rend (&frames); e = list_prev (e)) {
+		struct frame *f = list_entry (e, struct frame, f_elem);
+		if (!f->pinned) {
+			list_remove (e);
+			f->pinned = true;
+			frame = f;
+			break;
+		}
+	}
 	lock_release (&frames_lock);
 
+	if (frame == NULL)
+		PANIC ("vm_get_victim failed");
+
 	return frame;
 }
 
@@ -194,6 +204,7 @@ vm_get_frame (void) {
 	}
 
 	frame->page = NULL;
+	frame->pinned = false;
 	ASSERT (frame->page == NULL);
 
 	return frame;
@@ -265,6 +276,54 @@ vm_claim_page (void *va) {
 	return vm_do_claim_page (page);
 }
 
+/* Brings the user page containing UADDR into memory if needed and pins its frame, so that it is not evicted
+ * until vm_unpin_page () while a device reads or writes the frame directly.
+ * Returns the kernel address that corresponds to UADDR, or NULL if UADDR is not in a page of the current process
+ * or WRITE is true and the page is read-only. */
+void *
+vm_pin_page (void *uaddr, bool write) {
+	struct thread *t = thread_current ();
+	struct page *page = spt_find_page (&t->spt, uaddr);
+
+	if (page == NULL || (write && !page->writable))
+		return NULL;
+
+	for (;;) {
+		void *kva;
+
+		lock_acquire (&frames_lock);
+		kva = pml4_get_page (t->pml4, uaddr);
+		if (kva != NULL && !page->frame->pinned) {
+			page->frame->pinned = true;
+			lock_release (&frames_lock);
+
+			/* The device's writes bypass the MMU's dirty bit. */
+			if (write)
+				pml4_set_dirty (t->pml4, uaddr, true);
+			return kva;
+		}
+		lock_release (&frames_lock);
+
+		/* Either the page is out of memory, or it is being evicted and will be soon. */
+		if (kva != NULL)
+			thread_yield ();
+		else if (!vm_do_claim_page (page))
+			return NULL;
+	}
+}
+
+/* Releases the pin taken by vm_pin_page () on the page containing UADDR. */
+void
+vm_unpin_page (void *uaddr) {
+	struct page *page = spt_find_page (&thread_current ()->spt, uaddr);
+
+	ASSERT (page != NULL && page->frame->pinned);
+
+	lock_acquire (&frames_lock);
+	page->frame->pinned = false;
+	lock_release (&frames_lock);
+}
+
 /* Claim the PAGE and set up the mmu. */
 static bool
 vm_do_claim_page (struct page *page) {
@@ -289,7 +348,7 @@ vm_do_claim_page (struct page *page) {
 /* Initialize new supplemental page table */
 void
 supplemental_page_table_init (struct supplemental_page_table *spt) {
-	hash_init (&spt->pages, page_hash, page_less, NULL);
+	rhash_init (&spt->pages, page_hash, page_less, NULL);
 	list_init (&spt->mmap_file_list);
 }
 
@@ -299,10 +358,10 @@ supplemental_page_table_copy (struct supplemental_page_table *dst,
 		struct supplemental_page_table *src) {
 	struct thread *t = thread_current ();
 
-	struct hash_iterator i;
-	hash_first (&i, &src->pages);
-	while (hash_next (&i)) {
-		struct page *p_src = hash_entry (hash_cur (&i), struct page, hash_elem);
+	struct rhash_iterator i;
+	rhash_first (&i, &src->pages);
+	while (rhash_next (&i)) {
+		struct page *p_src = rhash_entry (rhash_cur (&i), struct page, hash_elem);
 		enum vm_type type = VM_TYPE (p_src->operations->type);
 
 		if (type == VM_UNINIT) {
@@ -377,10 +436,10 @@ supplemental_page_table_copy (struct supplemental_page_table *dst,
 /* Free the resource hold by the supplemental page table */
 void
 supplemental_page_table_kill (struct supplemental_page_table *spt) {
-	struct hash *pages = &spt->pages;
+	struct rhash *pages = &spt->pages;
 
 	/* Threads-tests. */
-	if (!pages->buckets)
+	if (!pages->slots)
 		return;
 
 	/* All mappings are implicitly unmapped when a process exits. */
@@ -391,22 +450,23 @@ supplemental_page_table_kill (struct supplemental_page_table *spt) {
 	}
 
 	/* Destroy all the supplemental_page_table hold by thread. */
-	hash_destroy (pages, page_destructor);
+	rhash_destroy (pages, page_destructor);
 }
 
-/* Returns a hash value for page p. */
-static unsigned
-page_hash (const struct hash_elem *p_, void *aux UNUSED) {
-	const struct page *p = hash_entry (p_, struct page, hash_elem);
-	return hash_bytes (&p->va, sizeof p->va);
+/* Returns a hash value for page p.  The table mixes the bits
+ * itself, so the address will do. */
+static uint64_t
+page_hash (const struct rhash_elem *p_, void *aux UNUSED) {
+	const struct page *p = rhash_entry (p_, struct page, hash_elem);
+	return (uint64_t) p->va;
 }
 
 /* Returns true if page a precedes page b. */
 static bool
-page_less (const struct hash_elem *a_,
-		   const struct hash_elem *b_, void *aux UNUSED) {
-	const struct page *a = hash_entry (a_, struct page, hash_elem);
-	const struct page *b = hash_entry (b_, struct page, hash_elem);
+page_less (const struct rhash_elem *a_,
+		   const struct rhash_elem *b_, void *aux UNUSED) {
+	const struct page *a = rhash_entry (a_, struct page, hash_elem);
+	const struct page *b = rhash_entry (b_, struct page, hash_elem);
 
 	return a->va < b->va;
 }
@@ -431,7 +491,7 @@ install_page (void *upage, void *kpage, bool writable) {
 }
 
 static void
-page_destructor (struct hash_elem *e, void *aux UNUSED) {
-	struct page *page = hash_entry (e, struct page, hash_elem);
+page_destructor (struct rhash_elem *e, void *aux UNUSED) {
+	struct page *page = rhash_entry (e, struct page, hash_elem);
 	vm_dealloc_page (page);
 }
\ No newline at end of file